@@ -0,0 +1,49 @@
+#include "Compiler.hpp"
+#include "Lexer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fmt/format.h>
+#include <limits>
+#include <string>
+
+/// `rack_lexer_bench <file> [runs]`: lexes `file` `runs` times on one
+/// thread and prints the best throughput. Only Compiler::create() and
+/// Lexer::lex() are used, which every revision of the lexer has, so
+/// bench/lexer.sh can build it against an older tree as well.
+int main(const int argc, const char** argv) {
+    if (argc < 2) {
+        fmt::print(stderr, "usage: {} <file> [runs]\n", argv[0]);
+        return 1;
+    }
+    const auto runs = argc > 2 ? std::stoul(argv[2]) : 5UL;
+
+    const auto compiler = Compiler::create(argv[1], "");
+    const auto size     = compiler->file_contents().size();
+
+    auto        best  = std::numeric_limits<double>::max();
+    std::size_t count = 0;
+    for (std::size_t run = 0; run < runs; ++run) {
+        const auto start  = std::chrono::steady_clock::now();
+        const auto tokens = Lexer::lex(compiler);
+        const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+        if (!tokens.has_value()) {
+            fmt::print(stderr, "lex error\n");
+            return 1;
+        }
+        count = tokens->size();
+        best  = std::min(best, elapsed.count());
+    }
+
+    const auto megabytes = static_cast<double>(size) / 1e6;
+    fmt::print(
+      "{} tokens, {:.1f} MB, best {:.3f}s: {:.0f} MB/s\n",
+      count,
+      megabytes,
+      best,
+      megabytes / best
+    );
+    return 0;
+}
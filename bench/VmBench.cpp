@@ -0,0 +1,72 @@
+#include "Assembler.hpp"
+#include "Compiler.hpp"
+#include "Ir.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Passes.hpp"
+#include "Vm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fmt/format.h>
+#include <limits>
+#include <string>
+
+/// `rack_vm_bench <file> [runs]`: compiles `file` to bytecode once, then
+/// runs it `runs` times on a fresh vm::Vm. The program writes to stdout as
+/// usual, the best time of the interpreter alone goes to stderr, in
+/// seconds, so bench/vm.sh can put it next to the native binaries'.
+int main(const int argc, const char** argv) {
+    if (argc < 2) {
+        fmt::print(stderr, "usage: {} <file> [runs]\n", argv[0]);
+        return 1;
+    }
+    const auto runs = argc > 2 ? std::stoul(argv[2]) : 3UL;
+
+    const auto compiler = Compiler::create(argv[1], "");
+
+    auto tokens = TokenStream::create(compiler);
+    if (!tokens.has_value()) {
+        compiler->print_errors();
+        return 1;
+    }
+
+    const auto program = Parser::parse(compiler, std::move(tokens.value()));
+    if (!program.has_value() || compiler->has_errors()) {
+        compiler->print_errors();
+        return 1;
+    }
+
+    // As generated, like the native binaries it is compared with
+    auto module = ir::lower(compiler, program.value());
+    if (!module.has_value() || compiler->has_errors()) {
+        compiler->print_errors();
+        return 1;
+    }
+    PassManager::create(OptimizationLevel::O0).run(module.value(), false);
+
+    const auto bytecode = BytecodeAssembler::assemble(module.value());
+    if (!bytecode.has_value()) {
+        fmt::print(stderr, "assemble error: {}\n", bytecode.error());
+        return 1;
+    }
+
+    auto best = std::numeric_limits<double>::max();
+    for (std::size_t run = 0; run < runs; ++run) {
+        // Translating to threaded code is part of running the program
+        const auto start   = std::chrono::steady_clock::now();
+        auto       machine = vm::Vm::create(bytecode.value());
+        if (!machine.has_value()) {
+            fmt::print(stderr, "vm error: {}\n", machine.error());
+            return 1;
+        }
+        machine->run();
+        const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+
+    fmt::print(stderr, "{:.3f}\n", best);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+# Single-threaded lexer throughput on a generated corpus: functions of
+# string literals, numbers, builtins and identifiers, about the given size.
+#
+# With a git revision, the same harness (bench/LexerBench.cpp) is also built
+# against the lexer of that revision and run on the same corpus, e.g. the
+# parent of the table-driven lexer: bench/lexer.sh build 7ee7395~1
+#
+# usage: bench/lexer.sh [build directory] [baseline revision] [megabytes]
+
+set -euo pipefail
+
+build=${1:-build}
+baseline=${2:-}
+megabytes=${3:-40}
+runs=5
+
+root=$(git -C "$(dirname "$0")" rev-parse --show-toplevel)
+
+cmake --build "$build" --target rack_lexer_bench > /dev/null
+
+work=$(mktemp -d)
+trap 'git -C "$root" worktree remove --force "$work/baseline" 2> /dev/null;
+      rm -rf "$work"' EXIT
+
+# 64 lines per function, about 70 bytes per line
+awk -v lines="$((megabytes * 1000000 / 70))" 'BEGIN {
+    srand(1)
+    for (line = 0; line < lines; ++line) {
+        if (line % 64 == 0) {
+            if (line > 0) print "end"
+            printf "fn func_%d -> i32\nbegin\n", line / 64
+        }
+        printf "    \"log line number %d with some text\\n\" puts %d print ident_%d_x\n", \
+            line, int(rand() * 1000000000), line
+    }
+    print "end"
+}' > "$work/corpus.rack"
+
+printf 'current   '
+"$build/rack_lexer_bench" "$work/corpus.rack" "$runs"
+
+if [[ -n $baseline ]]; then
+    git -C "$root" worktree add --detach "$work/baseline" "$baseline" \
+        > /dev/null 2>&1
+    sources=$(find "$work/baseline/src" -name '*.cpp' ! -name main.cpp)
+    # The flags of a Release build of the CMakeLists.txt
+    # shellcheck disable=SC2086
+    g++ -std=c++23 -O3 -DNDEBUG -fsanitize=undefined -pthread \
+        -I "$work/baseline/include" -I "$work/baseline/src" \
+        "$root/bench/LexerBench.cpp" $sources -o "$work/baseline_bench"
+    printf 'baseline  '
+    "$work/baseline_bench" "$work/corpus.rack" "$runs"
+fi
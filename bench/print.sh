@@ -0,0 +1,35 @@
+#!/usr/bin/env bash
+# Numbers per second of the native print routine against the one it
+# replaced, see src/PrintBench.c. Each harness runs a few times, the median
+# of every range is reported, in millions of numbers per second.
+#
+# usage: bench/print.sh [build directory] [runs]
+
+set -euo pipefail
+
+build=${1:-build}
+runs=${2:-5}
+
+cmake --build "$build" \
+    --target rack_print_bench_before rack_print_bench_after > /dev/null
+
+# Median of every range over $runs runs of $1, one "range median" per line
+medians() {
+    for _ in $(seq "$runs"); do "$1" 2>&1; done \
+        | sort -k1,1 -k2,2n \
+        | awk -v runs="$runs" '
+            { count[$1]++ }
+            count[$1] == int(runs / 2) + 1 { median[$1] = $2 }
+            END { for (range in median) print range, median[range] }'
+}
+
+before=$(medians "$build/rack_print_bench_before")
+after=$(medians "$build/rack_print_bench_after")
+
+printf 'median of %s runs, millions of numbers/s\n\n' "$runs"
+printf '%-8s %8s %8s\n' values before after
+for range in 0..99 0..1e9 0..2^63 -1e6..0; do
+    printf '%-8s %8s %8s\n' "$range" \
+        "$(awk -v r="$range" '$1 == r { print $2 }' <<< "$before")" \
+        "$(awk -v r="$range" '$1 == r { print $2 }' <<< "$after")"
+done
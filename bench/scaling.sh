@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+# Compile time against program size: N one-line functions and a main, for
+# N from 1K to 1M. begin/end matching has to stay linear, so the time per
+# function should not grow with N. Every figure is the best wall time of a
+# few compiles at -O0, writing the assembly too (-s), with the builtin
+# assembler and linker.
+#
+# usage: bench/scaling.sh [build directory] [runs]
+
+set -euo pipefail
+
+build=${1:-build}
+runs=${2:-3}
+
+cmake --build "$build" --target rack > /dev/null
+rack=$(realpath "$build/rack")
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Best wall time of "$@" over $runs runs, in nanoseconds
+best() {
+    local best_ns=
+    for _ in $(seq "$runs"); do
+        local start end
+        start=$(date +%s%N)
+        "$@" > /dev/null
+        end=$(date +%s%N)
+        if [[ -z $best_ns || $((end - start)) -lt $best_ns ]]; then
+            best_ns=$((end - start))
+        fi
+    done
+    echo "$best_ns"
+}
+
+printf '%10s %10s %10s\n' functions time "per fn"
+for functions in 1000 10000 100000 1000000; do
+    awk -v n="$functions" 'BEGIN {
+        for (idx = 0; idx < n; ++idx) {
+            printf "fn f_%d -> i32 begin \"f\\n\" puts %d print end\n", idx, idx
+        }
+        print "fn main -> i32 begin \"main\\n\" puts end"
+    }' > "$work/scaling.rack"
+
+    elapsed=$(best "$rack" "$work/scaling.rack" -s --linker builtin \
+        -o "$work/scaling")
+    awk -v n="$functions" -v ns="$elapsed" 'BEGIN {
+        printf "%10d %9.3fs %8.1fus\n", n, ns / 1e9, ns / 1e3 / n
+    }'
+done
@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+# Compares the throughput of the bytecode VM with the native executables,
+# on the same programs: a main repeating one statement N times.
+#
+#   native   the compiled executable, start to exit
+#   vm       the interpreter alone, translation included (rack_vm_bench)
+#   run --vm `rack run --vm` end to end: lexing, parsing and the VM
+#
+# Every figure is the best wall time of a few runs, output going to
+# /dev/null. Programs are compiled at -O0, so that both run the code as
+# generated rather than what the optimizer leaves of it.
+#
+# usage: bench/vm.sh [build directory] [statements] [runs]
+
+set -euo pipefail
+
+build=${1:-build}
+statements=${2:-1000000}
+runs=${3:-3}
+
+cmake --build "$build" --target rack rack_vm_bench > /dev/null
+rack=$(realpath "$build/rack")
+vm_bench=$(realpath "$build/rack_vm_bench")
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Writes a main repeating `$2` $statements times to $work/$1.rack
+generate() {
+    {
+        echo "fn main -> i32"
+        echo "begin"
+        awk -v n="$statements" -v s="    $2" \
+            'BEGIN { while (n-- > 0) print s }'
+        echo "end"
+    } > "$work/$1.rack"
+}
+
+# Best wall time of "$@" over $runs runs, in seconds
+best() {
+    local best_ns=
+    for _ in $(seq "$runs"); do
+        local start end
+        start=$(date +%s%N)
+        "$@" > /dev/null
+        end=$(date +%s%N)
+        if [[ -z $best_ns || $((end - start)) -lt $best_ns ]]; then
+            best_ns=$((end - start))
+        fi
+    done
+    printf '%d.%03d' $((best_ns / 1000000000)) $((best_ns / 1000000 % 1000))
+}
+
+# Millions of statements per second
+throughput() {
+    awk -v n="$statements" -v s="$1" 'BEGIN { printf "%.1f", n / s / 1e6 }'
+}
+
+generate puts '"hello\n" puts'
+generate print '12345 print'
+generate arith '7 6 * 5 - print'
+
+printf '%s statements per program, best of %s\n\n' "$statements" "$runs"
+printf '%-6s %10s %10s %10s %12s %12s\n' \
+    program native vm "run --vm" "native M/s" "vm M/s"
+
+for program in puts print arith; do
+    source="$work/$program.rack"
+    "$rack" "$source" -O0 -o "$work/$program" > /dev/null
+
+    native=$(best "$work/$program")
+    vm=$("$vm_bench" "$source" "$runs" 2>&1 > /dev/null)
+    run=$(best "$rack" run --vm "$source" -O0)
+
+    printf '%-6s %9ss %9ss %9ss %12s %12s\n' \
+        "$program" "$native" "$vm" "$run" \
+        "$(throughput "$native")" "$(throughput "$vm")"
+done
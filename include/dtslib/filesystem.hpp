@@ -1,11 +1,21 @@
 #ifndef DTS_FILESYSTEM_HPP
 #define DTS_FILESYSTEM_HPP
 
+#include <algorithm>
+#include <cerrno>
 #include <concepts>
+#include <cstddef>
 #include <expected>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iterator>
+#include <memory>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
 #include <vector>
 
 namespace dts {
@@ -33,10 +43,13 @@ template<BufferContainer Container>
     if (!file_handle) { return std::unexpected(FileStreamError::UnableToOpen); }
 
     if constexpr (std::same_as<Container, std::string>) {
-        return std::string(static_cast<const std::stringstream&>(
-                             std::stringstream() << file_handle.rdbuf()
-        )
-                             .str());
+        // Read straight into a pre-sized buffer, no intermediate stream copy
+        std::string retval(std::filesystem::file_size(path), '\0');
+        file_handle.read(
+          retval.data(), static_cast<std::streamsize>(retval.size())
+        );
+        retval.resize(static_cast<std::size_t>(file_handle.gcount()));
+        return retval;
     } else {
         const auto               file_size = std::filesystem::file_size(path);
         std::vector<std::string> retval    = {};
@@ -49,6 +62,148 @@ template<BufferContainer Container>
     }
 }
 
+/// Read-only view of a whole file that lives as long as the object.
+/// Regular files are mapped with MAP_PRIVATE, anything else (pipes, character
+/// devices) or files whose size is a multiple of the page size are read once
+/// into an owned buffer instead. Either way the contents are followed by at
+/// least one '\0' sentinel byte, so data()[size()] is always readable.
+class MappedFile {
+  public:
+    MappedFile() noexcept = default;
+
+    ~MappedFile() noexcept { this->reset(); }
+
+    MappedFile(const MappedFile& other)                    = delete;
+    auto operator=(const MappedFile& rhs) -> MappedFile& = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+      : m_data{ std::exchange(other.m_data, s_empty) },
+        m_size{ std::exchange(other.m_size, 0) },
+        m_mapping_size{ std::exchange(other.m_mapping_size, 0) },
+        m_buffer{ std::move(other.m_buffer) } {}
+
+    auto operator=(MappedFile&& rhs) noexcept -> MappedFile& {
+        if (this != &rhs) {
+            this->reset();
+            this->m_data         = std::exchange(rhs.m_data, s_empty);
+            this->m_size         = std::exchange(rhs.m_size, 0);
+            this->m_mapping_size = std::exchange(rhs.m_mapping_size, 0);
+            this->m_buffer       = std::move(rhs.m_buffer);
+        }
+        return *this;
+    }
+
+    [[nodiscard]] auto data() const noexcept -> const char* {
+        return this->m_data;
+    }
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t {
+        return this->m_size;
+    }
+
+    [[nodiscard]] auto view() const noexcept -> std::string_view {
+        return { this->m_data, this->m_size };
+    }
+
+    [[nodiscard]] auto is_mapped() const noexcept -> bool {
+        return this->m_mapping_size != 0;
+    }
+
+  private:
+    friend auto map_file(const std::string& file) noexcept
+      -> std::expected<MappedFile, FileStreamError>;
+
+    void reset() noexcept {
+        if (this->m_mapping_size != 0) {
+            ::munmap(const_cast<char*>(this->m_data), this->m_mapping_size);
+        }
+        this->m_data         = s_empty;
+        this->m_size         = 0;
+        this->m_mapping_size = 0;
+        this->m_buffer.reset();
+    }
+
+    static constexpr const char* s_empty = "";
+
+    const char*             m_data         = s_empty;
+    std::size_t             m_size         = 0;
+    std::size_t             m_mapping_size = 0;
+    std::unique_ptr<char[]> m_buffer;
+};
+
+[[nodiscard]] inline auto map_file(const std::string& file) noexcept
+  -> std::expected<MappedFile, FileStreamError> {
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::unexpected(
+          errno == ENOENT ? FileStreamError::NoSuchFile
+                          : FileStreamError::UnableToOpen
+        );
+    }
+
+    const auto close_fd = std::unique_ptr<const int, void (*)(const int*)>(
+      &fd, [](const int* handle) { ::close(*handle); }
+    );
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        return std::unexpected(FileStreamError::UnableToOpen);
+    }
+
+    if (S_ISDIR(info.st_mode)) {
+        return std::unexpected(FileStreamError::NonRegularFile);
+    }
+
+    MappedFile retval;
+    const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const auto file_size = static_cast<std::size_t>(info.st_size);
+
+    // The tail of the last page is zero-filled by the kernel, which gives us
+    // the sentinel for free unless the file ends exactly on a page boundary
+    if (S_ISREG(info.st_mode) && file_size != 0
+        && file_size % page_size != 0) {
+        void* mapping =
+          ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            ::madvise(mapping, file_size, MADV_SEQUENTIAL);
+            retval.m_data         = static_cast<const char*>(mapping);
+            retval.m_size         = file_size;
+            retval.m_mapping_size = file_size;
+            return retval;
+        }
+    }
+
+    // Fallback: read into a buffer sized from fstat, growing it only for
+    // streams that do not know their size up front
+    const bool  is_regular = S_ISREG(info.st_mode);
+    std::size_t capacity   = is_regular ? file_size : page_size;
+    std::size_t size       = 0;
+    auto        buffer     = std::make_unique<char[]>(capacity + 1);
+
+    while (!is_regular || size < capacity) {
+        if (size == capacity) {
+            auto grown = std::make_unique<char[]>(capacity * 2 + 1);
+            std::copy_n(buffer.get(), size, grown.get());
+            buffer = std::move(grown);
+            capacity *= 2;
+        }
+
+        const auto bytes_read = ::read(fd, buffer.get() + size, capacity - size);
+        if (bytes_read < 0) {
+            if (errno == EINTR) { continue; }
+            return std::unexpected(FileStreamError::UnableToOpen);
+        }
+        if (bytes_read == 0) { break; }
+        size += static_cast<std::size_t>(bytes_read);
+    }
+
+    buffer[size]    = '\0';
+    retval.m_data   = buffer.get();
+    retval.m_size   = size;
+    retval.m_buffer = std::move(buffer);
+    return retval;
+}
+
 template<typename ErrorType, typename Match>
 concept ErrorKind = std::same_as<std::remove_cvref_t<ErrorType>, Match>;
 
@@ -0,0 +1,25 @@
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+auto Arena::allocate(const std::size_t size, const std::size_t alignment)
+  -> void* {
+    const auto align = [&](std::byte* pointer) {
+        const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+        return pointer + ((alignment - address % alignment) % alignment);
+    };
+
+    auto* start = align(this->m_cursor);
+    if (this->m_cursor == nullptr || start + size > this->m_end) {
+        // Oversized requests get a block of their own
+        const auto capacity = std::max(Arena::block_size, size + alignment);
+        this->m_blocks.push_back(std::make_unique<std::byte[]>(capacity));
+        this->m_cursor = this->m_blocks.back().get();
+        this->m_end    = this->m_cursor + capacity;
+        start          = align(this->m_cursor);
+    }
+
+    this->m_cursor = start + size;
+    return start;
+}
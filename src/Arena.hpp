@@ -0,0 +1,57 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+/// Bump allocator for data living as long as the compilation, e.g. the AST.
+///
+/// Memory comes from large blocks and is only released, all at once, when
+/// the arena is destroyed: objects are never destructed, hence the
+/// restriction to trivially destructible types.
+class Arena {
+  public:
+    Arena()                                = default;
+    Arena(const Arena& other)              = delete;
+    Arena(Arena&& other) noexcept          = default;
+    Arena& operator=(const Arena& rhs)     = delete;
+    Arena& operator=(Arena&& rhs) noexcept = default;
+    ~Arena()                               = default;
+
+    /// Copies `items` into the arena, the result stays valid as long as the
+    /// arena does
+    template<typename T>
+    [[nodiscard]] auto copy(const std::span<const T> items)
+      -> std::span<const T> {
+        static_assert(
+          std::is_trivially_copyable_v<T>
+            && std::is_trivially_destructible_v<T>,
+          "[INTERNAL ERROR] Arena only holds trivially copyable and "
+          "destructible types"
+        );
+
+        if (items.empty()) { return {}; }
+
+        auto* storage = static_cast<T*>(
+          this->allocate(items.size_bytes(), alignof(T))
+        );
+        std::memcpy(storage, items.data(), items.size_bytes());
+        return { storage, items.size() };
+    }
+
+  private:
+    [[nodiscard]] auto
+      allocate(const std::size_t size, const std::size_t alignment) -> void*;
+
+    static constexpr std::size_t block_size = 1UL << 20U;
+
+    std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+    std::byte*                                m_cursor = nullptr;
+    std::byte*                                m_end    = nullptr;
+};
+
+#endif // ARENA_HPP
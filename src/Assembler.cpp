@@ -1,17 +1,114 @@
 #include "Assembler.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <fmt/ranges.h>
+#include <limits>
+
+namespace {
+
+[[nodiscard]] auto fits_i32(const std::int64_t value) -> bool {
+    return value >= std::numeric_limits<std::int32_t>::min()
+           && value <= std::numeric_limits<std::int32_t>::max();
+}
+
+/// Bytes of out_buffer: print writes straight into it, even unbuffered
+[[nodiscard]] auto buffer_size(const OutputBuffering& buffering)
+  -> std::size_t {
+    return std::max(buffering.size, OutputBuffering::min_size);
+}
+
+} // namespace
+
 Assembler::Assembler(const std::string& output_filename)
-  : m_output_file{ std::make_unique<std::ofstream>(
-    std::ofstream(output_filename, std::ios::out | std::ios::trunc)
-  ) } {}
+  : m_output_file{ output_filename.empty()
+                     ? nullptr
+                     : std::make_unique<std::ofstream>(std::ofstream(
+                       output_filename, std::ios::out | std::ios::trunc
+                     )) } {}
+
+Assembler::~Assembler() { this->flush(); }
+
+void Assembler::flush() {
+    // Textual output disabled, or moved-from assembler
+    if (this->m_output_file == nullptr) { return; }
+
+    this->m_output_file->write(
+      this->m_output.data(), static_cast<std::streamsize>(this->m_output.size())
+    );
+    this->m_output.clear();
+}
+
+auto Assembler::compile_to_assembly(const ir::Module& module)
+  -> std::expected<void, AssembleError> {
+    this->m_strings = module.strings.layout();
+
+    // Things like: BITS64, section .text, global _start...
+    this->generate_assembly_header();
+
+    // Already defined functions like: print...
+    this->generate_assembly_prelude();
+
+    for (const auto& function : module.functions) {
+        this->compile_function(function);
+    }
+
+    // Effective program entry point
+    this->generate_assembly_start_label();
+
+    // Data section
+    this->generate_data_section();
+
+    return {};
+}
 
-void Assembler::writeln(const std::string_view str) {
-    *this->m_output_file << str << '\n';
+void Assembler::compile_function(const ir::Function& function) {
+    static_assert(
+      std::to_underlying(ir::Opcode::Max) == 7,
+      "[INTERNAL ERROR] Assembler::compile_function() requires to handle all "
+      "opcodes"
+    );
+
+    this->generate_function_begin(function.name);
+
+    for (const auto& instruction : function.body) {
+        switch (instruction.opcode) {
+            case ir::Opcode::Const: {
+                this->generate_constant(instruction.immediate);
+                break;
+            }
+            case ir::Opcode::String: {
+                this->generate_string(
+                  static_cast<std::size_t>(instruction.immediate)
+                );
+                break;
+            }
+            case ir::Opcode::Add:
+            case ir::Opcode::Sub:
+            case ir::Opcode::Mul: {
+                this->generate_arithmetic(instruction.opcode);
+                break;
+            }
+            case ir::Opcode::Call: {
+                this->generate_builtin_call(instruction.builtin);
+                break;
+            }
+            case ir::Opcode::Return: {
+                this->generate_function_end();
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
 }
 
 auto Assembler_x86_64::compile(
   const std::shared_ptr<Compiler>& compiler,
-  const std::vector<Token>&        tokens
+  const ir::Module&                module,
+  const OutputBuffering&           buffering,
+  x86::PeepholeStats&              peephole_stats
 ) -> std::expected<void, AssembleError> {
     const auto output_path     = std::filesystem::path(compiler->output());
     const auto parent_path     = output_path.parent_path();
@@ -24,393 +121,769 @@ auto Assembler_x86_64::compile(
         return std::unexpected(AssembleError::NoSuchFileOrDirectory);
     }
 
-    Assembler_x86_64 assembler(compiler, tokens, output_filename);
-    return assembler.compile_to_assembly();
+    Assembler_x86_64 assembler(output_filename, buffering);
+    const auto       result = assembler.compile_to_assembly(module);
+    for (std::size_t rule = 0; rule < peephole_stats.size(); ++rule) {
+        peephole_stats[rule] += assembler.m_peephole_stats[rule];
+    }
+    return result;
 }
 
 Assembler_x86_64::Assembler_x86_64(
-  const std::shared_ptr<Compiler>& compiler,
-  const std::vector<Token>&        tokens,
-  const std::string&               output_filename
+  const std::string&     output_filename,
+  const OutputBuffering& buffering
 )
   : Assembler(output_filename),
-    m_compiler{ compiler },
-    m_tokens{ tokens } {}
+    m_buffering{ buffering },
+    m_free_registers(
+      Assembler_x86_64::scratch_registers.rbegin(),
+      Assembler_x86_64::scratch_registers.rend()
+    ) {}
 
-auto Assembler_x86_64::compile_to_assembly()
-  -> std::expected<void, AssembleError> {
-    // Things like: BITS64, section .text, global _start...
-    this->generate_assembly_header();
-
-    // Already defined functions like: print...
-    this->generate_assembly_prelude();
+auto Assembler_x86_64::generate_assembly_prelude() -> void {
+    // Assembled once into the runtime library, see src/Runtime.s
+    this->writeln("extern print");
+    this->writeln("extern puts\n");
+}
 
-    auto&& token = this->next();
-    while (token.error() != AssembleError::Eof) {
-        if (!token.has_value()) { return std::unexpected(token.error()); }
-        token = this->next();
+void Assembler_x86_64::emit(const x86::Instruction& instruction) {
+    this->m_listing.emplace_back(instruction);
+    if (this->m_listing.size() >= Assembler_x86_64::max_listing) {
+        this->write_listing();
     }
+}
 
-    // Effective program entry point
-    this->generate_assembly_start_label();
+void Assembler_x86_64::emit_label(const std::string& name, const bool global) {
+    this->m_listing.emplace_back(
+      x86::LabelDefinition{ .name = name, .global = global }
+    );
+}
 
-    // Data section
-    this->generate_data_section();
+void Assembler_x86_64::write_listing() {
+    x86::peephole(this->m_listing, this->m_peephole_stats);
 
-    return {};
+    for (const auto& entry : this->m_listing) {
+        if (const auto* label = std::get_if<x86::LabelDefinition>(&entry)) {
+            this->write_label(label->name, label->global);
+        } else {
+            this->write_instruction(std::get<x86::Instruction>(entry));
+        }
+    }
+    this->m_listing.clear();
 }
 
-auto Assembler_x86_64::generate_assembly_prelude() -> void {
-    // print
-    this->writeln("print:");
-    this->writeln("\tmov r9, -3689348814741910323");
-    this->writeln("\tsub rsp, 40");
-    this->writeln("\tmov BYTE [rsp+31], 10");
-    this->writeln("\tlea rcx, [rsp+30]");
-    this->writeln(".L2:");
-    this->writeln("\tmov rax, rdi");
-    this->writeln("\tlea r8, [rsp+32]");
-    this->writeln("\tmul r9");
-    this->writeln("\tmov rax, rdi");
-    this->writeln("\tsub r8, rcx");
-    this->writeln("\tshr rdx, 3");
-    this->writeln("\tlea rsi, [rdx+rdx*4]");
-    this->writeln("\tadd rsi, rsi");
-    this->writeln("\tsub rax, rsi");
-    this->writeln("\tadd eax, 48");
-    this->writeln("\tmov BYTE [rcx], al");
-    this->writeln("\tmov rax, rdi");
-    this->writeln("\tmov rdi, rdx");
-    this->writeln("\tmov rdx, rcx");
-    this->writeln("\tsub rcx, 1");
-    this->writeln("\tcmp rax, 9");
-    this->writeln("\tja .L2");
-    this->writeln("\tlea rax, [rsp+32]");
-    this->writeln("\tmov edi, 1");
-    this->writeln("\tsub rdx, rax");
-    this->writeln("\txor eax, eax");
-    this->writeln("\tlea rsi, [rsp+32+rdx]");
-    this->writeln("\tmov rdx, r8");
-    this->writeln("\tmov rax, 1");
-    this->writeln("\tsyscall");
-    this->writeln("\tadd rsp, 40");
-    this->writeln("\tret\n");
-
-    // puts
-    this->writeln("puts:");
-    this->writeln("\tmov rax, 1");
-    this->writeln("\tmov rdi, 1");
-    this->writeln("\tmov rsi, r9");
-    this->writeln("\tmov rdx, r8");
-    this->writeln("\tsyscall");
-    this->writeln("\tret\n");
+void Assembler_x86_64::write_instruction(const x86::Instruction& instruction) {
+    this->writeln("\t{}", instruction);
+}
+
+void Assembler_x86_64::write_label(const std::string& name, const bool global) {
+    // Every function has a section of its own, the linker drops the ones
+    // nothing refers to (--gc-sections)
+    if (!name.starts_with('.')) {
+        this->writeln(
+          "section .text.{} progbits alloc exec nowrite align=16", name
+        );
+    }
+    if (global) { this->writeln("global {}", name); }
+    this->writeln("{}:", name);
 }
 
 void Assembler_x86_64::generate_assembly_header() {
-    this->writeln("BITS 64");
-    this->writeln("section .text\n");
+    this->writeln("BITS 64\n");
 }
 
 void Assembler_x86_64::generate_assembly_start_label() {
-    this->writeln("global _start");
-    this->writeln("_start:");
-
-    this->writeln("\tcall func_main");
-    this->writeln("\tmov rax, 60");
-    this->writeln("\tmov rdi, 0");
-    this->writeln("\tsyscall\n");
+    // _start is part of the runtime library, it calls func_main
 }
 
 void Assembler_x86_64::generate_data_section() {
-    this->writeln("section .data");
+    this->writeln("section .rodata");
 
-    // TODO: Change this to zip, iota when zip ships
-    std::size_t idx = 0;
-    for (const auto& str : this->m_strings) {
-        this->writeln(fmt::format("\tstr_{}: db `{}`", std::to_string(idx), str)
+    // Output buffer settings the runtime library reads
+    this->writeln("global out_capacity");
+    this->writeln("out_capacity: dq {}", this->m_buffering.size);
+    this->writeln("global out_flush_on_newline");
+    this->writeln(
+      "out_flush_on_newline: db {}", this->m_buffering.flush_on_newline ? 1 : 0
+    );
+
+    // Raw bytes, the escapes were decoded by the StringPool
+    this->writeln("strings:");
+    const std::string_view bytes = this->m_strings.bytes;
+    for (std::size_t idx = 0; idx < bytes.size(); idx += 16) {
+        this->writeln(
+          "\tdb {:#04x}",
+          fmt::join(
+            bytes.substr(idx, 16) | std::views::transform([](const char ch) {
+                return static_cast<unsigned char>(ch);
+            }),
+            ", "
+          )
         );
-        ++idx;
     }
     this->writeln("\n");
+
+    this->writeln("section .bss");
+    this->writeln("global out_buffer");
+    this->writeln("out_buffer: resb {}", buffer_size(this->m_buffering));
+    this->writeln("");
+
+    // The stack does not have to be executable
+    this->writeln("section .note.GNU-stack noalloc noexec nowrite progbits");
+}
+
+void Assembler_x86_64::generate_function_begin(const std::string_view name) {
+    // main is called from the runtime library
+    this->emit_label(fmt::format("func_{}", name), name == "main");
+}
+
+void Assembler_x86_64::generate_function_end() {
+    // Values left behind are dropped, only the spilled ones take space
+    const auto spilled = std::ranges::count_if(
+      this->m_stack,
+      [](const x86::Operand& value) {
+          return std::holds_alternative<std::monostate>(value);
+      }
+    );
+    if (spilled != 0) {
+        this->emit(
+          { x86::Mnemonic::Add,
+            x86::Register::Rsp,
+            x86::Immediate{ 8 * spilled } }
+        );
+    }
+    this->m_stack.clear();
+    this->m_first_register = 0;
+    this->m_free_registers.assign(
+      Assembler_x86_64::scratch_registers.rbegin(),
+      Assembler_x86_64::scratch_registers.rend()
+    );
+
+    this->emit({ x86::Mnemonic::Ret });
+    this->write_listing();
+    this->writeln("");
+}
+
+void Assembler_x86_64::generate_constant(const std::int64_t value) {
+    this->m_stack.emplace_back(x86::Immediate{ value });
+}
+
+void Assembler_x86_64::generate_string(const std::size_t index) {
+    this->m_stack.emplace_back(x86::Memory{
+      .displacement =
+        static_cast<std::int32_t>(this->m_strings.offsets[index]),
+      .symbol = "strings",
+    });
+}
+
+void Assembler_x86_64::pop_into(const x86::Register reg) {
+    using enum x86::Mnemonic;
+
+    const auto value = std::move(this->m_stack.back());
+    this->m_stack.pop_back();
+    this->m_first_register =
+      std::min(this->m_first_register, this->m_stack.size());
+
+    if (std::holds_alternative<std::monostate>(value)) {
+        this->emit({ Pop, reg });
+    } else if (const auto* src = std::get_if<x86::Register>(&value)) {
+        if (*src != reg) { this->emit({ Mov, reg, *src }); }
+        this->release_register(*src);
+    } else if (std::holds_alternative<x86::Memory>(value)) {
+        this->emit({ Lea, reg, value });
+    } else {
+        this->emit({ Mov, reg, value });
+    }
 }
 
-auto Assembler_x86_64::span(const std::size_t start, const std::size_t end)
-  const -> Span {
-    return Span::create(this->m_compiler->target(), start, end);
+auto Assembler_x86_64::pop_operand() -> x86::Operand {
+    if (std::holds_alternative<std::monostate>(this->m_stack.back())) {
+        const auto reg = this->allocate_register();
+        this->pop_into(reg);
+        return reg;
+    }
+
+    auto value = std::move(this->m_stack.back());
+    this->m_stack.pop_back();
+    this->m_first_register =
+      std::min(this->m_first_register, this->m_stack.size());
+    return value;
 }
 
-void Assembler_x86_64::error(const std::string& message, const Span& span) {
-    this->m_compiler->push_error(RackError{ message, span });
+auto Assembler_x86_64::to_register(const x86::Operand& value)
+  -> x86::Register {
+    using enum x86::Mnemonic;
+
+    if (const auto* reg = std::get_if<x86::Register>(&value)) { return *reg; }
+
+    const auto reg = this->allocate_register();
+    this->emit(
+      { std::holds_alternative<x86::Memory>(value) ? Lea : Mov, reg, value }
+    );
+    return reg;
 }
 
-auto Assembler_x86_64::eof() const -> bool {
-    return this->m_cursor >= this->m_tokens.size();
+auto Assembler_x86_64::allocate_register() -> x86::Register {
+    if (this->m_free_registers.empty()) { this->spill(1); }
+
+    const auto reg = this->m_free_registers.back();
+    this->m_free_registers.pop_back();
+    return reg;
 }
 
-auto Assembler_x86_64::peek() const -> std::expected<Token, AssembleError> {
-    if (this->eof()) { return std::unexpected(AssembleError::Eof); }
-    return this->m_tokens[this->m_cursor];
+void Assembler_x86_64::release_register(const x86::Register reg) {
+    this->m_free_registers.push_back(reg);
 }
 
-auto Assembler_x86_64::peek_ahead(const std::size_t offset) const
-  -> std::expected<Token, AssembleError> {
-    if (this->m_cursor + offset >= this->m_tokens.size() - 1) {
-        return std::unexpected(AssembleError::Eof);
+void Assembler_x86_64::spill(const std::size_t count) {
+    std::size_t spilled = 0;
+    auto        idx     = this->m_first_register;
+    for (; idx < this->m_stack.size() && spilled < count; ++idx) {
+        const auto* reg = std::get_if<x86::Register>(&this->m_stack[idx]);
+        if (reg == nullptr) { continue; }
+
+        this->emit({ x86::Mnemonic::Push, *reg });
+        this->release_register(*reg);
+        this->m_stack[idx] = std::monostate{};
+        ++spilled;
     }
-    return this->m_tokens[this->m_cursor + offset];
+    this->m_first_register = idx;
 }
 
-auto Assembler_x86_64::next() -> std::expected<void, AssembleError> {
-    const auto& current_token = this->peek();
-    if (!current_token.has_value()) {
-        return std::unexpected(current_token.error());
+void Assembler_x86_64::generate_arithmetic(const ir::Opcode opcode) {
+    using enum x86::Mnemonic;
+
+    auto rhs = this->pop_operand();
+    auto lhs = this->pop_operand();
+
+    // Constants go to the right, where instructions take immediates
+    if (opcode != ir::Opcode::Sub
+        && std::holds_alternative<x86::Immediate>(lhs)) {
+        std::swap(lhs, rhs);
     }
 
-    const auto lexeme = current_token->lexeme();
+    const auto  dst      = this->to_register(lhs);
+    const auto* constant = std::get_if<x86::Immediate>(&rhs);
 
-    switch (current_token->type()) {
-        case TokenType::KeywordOrIdentifier: {
-            static_assert(
-              std::to_underlying(TokenType::Max) == 10,
-              "[INTERNAL ERROR] Assembler_x86_64::next() requires to handle "
-              "all enum variants"
+    if (opcode == ir::Opcode::Mul && constant != nullptr) {
+        this->multiply(dst, constant->value);
+    } else if (constant != nullptr && fits_i32(constant->value)) {
+        if (constant->value != 0) {
+            this->emit(
+              { opcode == ir::Opcode::Add ? Add : Sub, dst, *constant }
             );
-            if (lexeme == "fn") {
-                return this->compile_function();
-            } else {
-                // FIXME: Once we handle all the keyword/identifiers make this
-                //        an unknown keyword/identifier error
-                fmt::println(
-                  "[INTERNAL ERROR] unimplemented {} keyword/identifier "
-                  "compilation! (skipping)",
-                  lexeme
-                );
-                ++this->m_cursor;
-            }
-            break;
         }
-        default: {
-            // FIXME: Once we handle all the tokens make this an unknown token error
-            fmt::println(
-              "[INTERNAL ERROR] unimplemented {} token compilation! (skipping)",
-              lexeme
+    } else {
+        const auto src = this->to_register(rhs);
+        const auto mnemonic =
+          opcode == ir::Opcode::Add ? Add
+                                    : (opcode == ir::Opcode::Sub ? Sub : Imul);
+        this->emit({ mnemonic, dst, src });
+        this->release_register(src);
+    }
+
+    this->m_stack.emplace_back(dst);
+}
+
+void Assembler_x86_64::multiply(
+  const x86::Register reg,
+  const std::int64_t  value
+) {
+    using enum x86::Mnemonic;
+
+    const auto bits = static_cast<std::uint64_t>(value);
+    if (bits == 0) {
+        this->emit({ Mov, reg, x86::Immediate{ 0 } });
+        return;
+    }
+    if (value == -1) {
+        this->emit({ Neg, reg });
+        return;
+    }
+
+    // value = odd << shift: lea multiplies by 3, 5 and 9, shl by the power
+    // of two
+    const auto shift = std::countr_zero(bits);
+    const auto odd   = bits >> static_cast<unsigned>(shift);
+    if (odd == 1 || odd == 3 || odd == 5 || odd == 9) {
+        if (odd != 1) {
+            this->emit(
+              { Lea,
+                reg,
+                x86::Memory{ .base  = reg,
+                             .index = reg,
+                             .scale = static_cast<std::uint8_t>(odd - 1) } }
             );
-            ++this->m_cursor;
         }
+        if (shift != 0) { this->emit({ Shl, reg, x86::Immediate{ shift } }); }
+        return;
     }
 
-    return {};
+    if (fits_i32(value)) {
+        this->emit({ Imul, reg, x86::Immediate{ value } });
+        return;
+    }
+
+    const auto factor = this->allocate_register();
+    this->emit({ Mov, factor, x86::Immediate{ value } });
+    this->emit({ Imul, reg, factor });
+    this->release_register(factor);
 }
 
-auto Assembler_x86_64::find_nearest_end() const
-  -> std::expected<std::size_t, AssembleError> {
-    const auto index = std::distance(
-      this->m_tokens.begin(),
-      std::find_if(
-        this->m_tokens.begin(),
-        this->m_tokens.end(),
-        [](const auto& token) {
-            return token.lexeme() == "end"
-                   && token.type() == TokenType::KeywordOrIdentifier;
-        }
-      )
+void Assembler_x86_64::generate_builtin_call(const Builtin builtin) {
+    static_assert(
+      std::to_underlying(Builtin::Max) == 3,
+      "[INTERNAL ERROR] Assembler_x86_64::generate_builtin_call() requires to "
+      "handle all builtins"
     );
 
-    if (static_cast<std::size_t>(index) >= this->m_tokens.size()) {
-        return std::unexpected(AssembleError::NoEndToken);
+    using enum x86::Mnemonic;
+    using x86::Register::R8, x86::Register::R9, x86::Register::Rdi;
+
+    switch (builtin) {
+        case Builtin::Print: {
+            this->pop_into(Rdi);
+            this->spill(this->m_stack.size());
+            this->emit({ Call, x86::Label{ "print" } });
+            break;
+        }
+        case Builtin::Puts: {
+            this->pop_into(R9);
+            this->pop_into(R8);
+            this->spill(this->m_stack.size());
+            this->emit({ Call, x86::Label{ "puts" } });
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+auto ElfAssembler_x86_64::compile(
+  const std::shared_ptr<Compiler>& compiler,
+  const ir::Module&                module,
+  const bool                       keep_assembly,
+  const Output                     output,
+  const OutputBuffering&           buffering,
+  const std::string&               runtime_library,
+  x86::PeepholeStats&              peephole_stats
+) -> std::expected<void, AssembleError> {
+    const auto output_path = std::filesystem::path(compiler->output());
+    const auto parent_path = output_path.parent_path();
+    const auto output_stem =
+      fmt::format("{}/{}", parent_path.string(), output_path.stem().string());
+
+    if (!std::filesystem::exists(parent_path)) {
+        // TODO: Implement a way to push errors without span
+        return std::unexpected(AssembleError::NoSuchFileOrDirectory);
     }
 
-    return index;
+    ElfAssembler_x86_64 assembler(
+      keep_assembly ? fmt::format("{}.asm", output_stem) : "",
+      output == Output::Object ? fmt::format("{}.o", output_stem)
+                               : output_path.string(),
+      output,
+      buffering,
+      runtime_library
+    );
+    const auto result = assembler.compile_to_assembly(module);
+    for (std::size_t rule = 0; rule < peephole_stats.size(); ++rule) {
+        peephole_stats[rule] += assembler.m_peephole_stats[rule];
+    }
+    return result;
+}
+
+auto ElfAssembler_x86_64::assemble(const ir::Module& module)
+  -> std::expected<elf::ObjectFile, AssembleError> {
+    ElfAssembler_x86_64 assembler("", "", Output::Module, {}, "");
+
+    const auto result = assembler.compile_to_assembly(module);
+    if (!result.has_value()) { return std::unexpected(result.error()); }
+
+    return std::move(assembler.m_object);
 }
 
-auto Assembler_x86_64::compile_function()
+ElfAssembler_x86_64::ElfAssembler_x86_64(
+  const std::string&     assembly_filename,
+  std::string            output_filename,
+  const Output           output,
+  const OutputBuffering& buffering,
+  std::string            runtime_library
+)
+  : Assembler_x86_64(assembly_filename, buffering),
+    m_output_filename{ std::move(output_filename) },
+    m_output_kind{ output },
+    m_runtime_library{ std::move(runtime_library) },
+    m_rodata{ this->m_object.add_section(
+      ".rodata", elf::SectionKind::ReadOnlyData, 8
+    ) } {}
+
+auto ElfAssembler_x86_64::compile_to_assembly(const ir::Module& module)
   -> std::expected<void, AssembleError> {
-    // Skip "fn" token
-    const auto fn_keyword = this->peek().value();
-    ++this->m_cursor;
-
-    // Get function identifier
-    const auto function_name = this->peek();
-    if (!function_name.has_value()) {
-        this->error(
-          "expected identifier after 'fn' keyword, function name is missing",
-          fn_keyword.span()
+    const auto result = Assembler::compile_to_assembly(module);
+    if (!result.has_value()) { return result; }
+
+    this->resolve_fixups();
+    if (this->m_output_kind == Output::Module) { return {}; }
+
+    return this->write_output();
+}
+
+auto ElfAssembler_x86_64::write_output()
+  -> std::expected<void, AssembleError> {
+    const auto bytes =
+      [&]() -> std::expected<std::vector<std::uint8_t>, AssembleError> {
+        if (this->m_output_kind == Output::Object) {
+            return this->m_object.serialize();
+        }
+
+        std::ifstream runtime(
+          this->m_runtime_library, std::ios::in | std::ios::binary
         );
-        return std::unexpected(AssembleError::MissingFunctionName);
-    }
-    ++this->m_cursor;
-
-    // Write function label
-    this->writeln(fmt::format("func_{}:", function_name->lexeme()));
-
-    // Check if function has parameter list
-    const auto has_params = [&]() -> bool {
-        const auto next_token = this->peek();
-        if (!next_token.has_value()) {
-            this->error(
-              "expected parameter list or return type after function name",
-              function_name->span()
+        const auto objects = elf::ObjectFile::read_archive(
+          std::vector<std::uint8_t>(
+            std::istreambuf_iterator<char>(runtime),
+            std::istreambuf_iterator<char>()
+          )
+        );
+        if (!runtime.is_open() || !objects.has_value()) {
+            fmt::print(stderr, fmt::fg(fmt::color::red), "error");
+            fmt::print(
+              stderr,
+              fmt::emphasis::bold,
+              ": cannot read the runtime library `{}`\n",
+              this->m_runtime_library
             );
-            return false;
+            return std::unexpected(AssembleError::LinkFailure);
+        }
+        for (const auto& object : objects.value()) {
+            this->m_object.append(object);
         }
 
-        return next_token->type() == TokenType::MinusMinus;
-    }();
+        // Nothing else gets linked in, every symbol must be defined by now
+        const auto undefined = this->m_object.undefined_symbols();
+        for (const auto& symbol : undefined) {
+            fmt::print(stderr, fmt::fg(fmt::color::red), "error");
+            fmt::print(
+              stderr, fmt::emphasis::bold, ": undefined symbol `{}`\n", symbol
+            );
+        }
+        if (!undefined.empty()) {
+            return std::unexpected(AssembleError::LinkFailure);
+        }
 
-    // Parse parameter list
-    if (has_params) {
-        FMT_ASSERT(
-          false,
-          "[INTERNAL ERROR] Unimplemented function parameter list parsin\n"
-        );
-        // const auto parameter_list = this->parse_function_parameter_list();
-    }
+        auto executable = this->m_object.link("_start");
+        if (!executable.has_value()) {
+            fmt::print(
+              stderr,
+              "[INTERNAL ERROR] cannot link {}: {}\n",
+              this->m_output_filename,
+              executable.error()
+            );
+            return std::unexpected(AssembleError::LinkFailure);
+        }
+        return std::move(executable.value());
+    }();
+    if (!bytes.has_value()) { return std::unexpected(bytes.error()); }
 
-    // Check return type
-    const auto arrow = this->peek();
-    if (!arrow.has_value() || arrow->type() != TokenType::Arrow) {
-        // FIXME: This span is not always correct: it should be either the function name's
-        //        span or the last function parameter's span
-        this->error(
-          "expected return type after function name or parameter list",
-          function_name->span()
-        );
-        return std::unexpected(
-          AssembleError::MissingFunctionParametersOrReturnType
+    {
+        std::ofstream file(
+          this->m_output_filename,
+          std::ios::out | std::ios::trunc | std::ios::binary
         );
-    }
-    ++this->m_cursor;
-
-    const auto return_type = this->peek();
-    // FIXME: Check if return type is a valid return type
-    if (!return_type.has_value()) {
-        this->error(
-          "expected return type after function name or parameter list",
-          arrow->span()
-        );
-        return std::unexpected(
-          AssembleError::MissingFunctionParametersOrReturnType
+        file.write(
+          reinterpret_cast<const char*>(bytes->data()),
+          static_cast<std::streamsize>(bytes->size())
         );
+        if (!file) {
+            return std::unexpected(AssembleError::ObjectWriteFailure);
+        }
     }
-    ++this->m_cursor;
 
-    const auto begin_token = this->peek();
-    if (!begin_token.has_value()) {
-        this->error(
-          "expected begin after function return type", return_type->span()
+    if (this->m_output_kind == Output::Executable) {
+        using std::filesystem::perms;
+
+        std::error_code error;
+        std::filesystem::permissions(
+          this->m_output_filename,
+          perms::owner_all | perms::group_read | perms::group_exec
+            | perms::others_read | perms::others_exec,
+          error
         );
-        return std::unexpected(AssembleError::NoBeginToken);
+        if (error) {
+            return std::unexpected(AssembleError::ObjectWriteFailure);
+        }
     }
-    ++this->m_cursor;
 
-    const auto function_body_result = this->compile_function_body();
+    return {};
+}
+
+void ElfAssembler_x86_64::write_instruction(
+  const x86::Instruction& instruction
+) {
+    Assembler_x86_64::write_instruction(instruction);
 
-    if (!function_body_result.has_value()) {
-        this->error(
-          "expected end token after function body", this->peek()->span()
+    this->m_encoded.clear();
+    const auto result = x86::encode(
+      instruction, this->m_object.data(this->m_text), this->m_encoded
+    );
+    if (!result.has_value()) {
+        fmt::print(
+          stderr,
+          "[INTERNAL ERROR] cannot encode `{}`: {}\n",
+          instruction,
+          result.error()
         );
-        return std::unexpected(function_body_result.error());
+        std::abort();
     }
-    ++this->m_cursor;
 
-    this->writeln("\tret\n");
+    for (auto& fixup : this->m_encoded) {
+        if (fixup.symbol.starts_with('.')) {
+            fixup.symbol = this->qualified_name(fixup.symbol);
+        }
+        this->m_fixups.push_back({ this->m_text, std::move(fixup) });
+    }
+}
 
-    return {};
+void ElfAssembler_x86_64::write_label(
+  const std::string& name,
+  const bool         global
+) {
+    Assembler_x86_64::write_label(name, global);
+
+    if (name.starts_with('.')) {
+        this->m_labels[this->qualified_name(name)] = {
+            this->m_text, this->m_object.data(this->m_text).size()
+        };
+        return;
+    }
+
+    // A function, in a section of its own
+    this->m_text = this->m_object.add_section(
+      fmt::format(".text.{}", name), elf::SectionKind::Code, 16
+    );
+    this->m_scope        = name;
+    this->m_labels[name] = { this->m_text, 0 };
+    std::ignore          = this->m_object.add_symbol(elf::Symbol{
+      .name    = name,
+      .section = this->m_text,
+      .binding =
+        global ? elf::SymbolBinding::Global : elf::SymbolBinding::Local,
+      .type = elf::SymbolType::Function,
+    });
 }
 
-auto Assembler_x86_64::compile_function_body()
-  -> std::expected<void, AssembleError> {
-    auto&& token = this->peek();
+void ElfAssembler_x86_64::generate_data_section() {
+    Assembler_x86_64::generate_data_section();
+
+    const auto add_object = [&](const std::string&  name,
+                                const std::uint32_t section,
+                                const std::uint64_t offset,
+                                const std::uint64_t size,
+                                const bool          global) {
+        this->m_labels[name] = { section, offset };
+        std::ignore          = this->m_object.add_symbol(elf::Symbol{
+          .name    = name,
+          .section = section,
+          .value   = offset,
+          .size    = size,
+          .binding =
+            global ? elf::SymbolBinding::Global : elf::SymbolBinding::Local,
+          .type = elf::SymbolType::Object,
+        });
+    };
+
+    auto& rodata = this->m_object.data(this->m_rodata);
+
+    // The host runtime of a module has no output buffer
+    if (this->m_output_kind != Output::Module) {
+        auto capacity = static_cast<std::uint64_t>(this->m_buffering.size);
+        for (std::size_t byte = 0; byte < sizeof(capacity); ++byte) {
+            rodata.push_back(static_cast<std::uint8_t>(capacity));
+            capacity >>= 8U;
+        }
+        add_object("out_capacity", this->m_rodata, 0, 8, true);
+
+        rodata.push_back(this->m_buffering.flush_on_newline ? 1 : 0);
+        add_object("out_flush_on_newline", this->m_rodata, 8, 1, true);
+    }
 
-    const auto end_index = this->find_nearest_end();
-    if (!end_index.has_value()) { return std::unexpected(end_index.error()); }
+    const auto& bytes  = this->m_strings.bytes;
+    const auto  offset = rodata.size();
+    rodata.insert(rodata.end(), bytes.begin(), bytes.end());
+    add_object("strings", this->m_rodata, offset, bytes.size(), false);
+
+    if (this->m_output_kind == Output::Module) { return; }
+    const auto bss =
+      this->m_object.add_section(".bss", elf::SectionKind::Uninitialized, 8);
+    const auto size = buffer_size(this->m_buffering);
+    const auto buffer = this->m_object.reserve(bss, size);
+    add_object("out_buffer", bss, buffer, size, true);
+}
 
-    while (this->m_cursor != end_index.value()) {
-        switch (token->type()) {
-            case TokenType::DoubleQuotedString: {
-                this->compile_double_quoted_string(token.value());
-                break;
-            }
-            case TokenType::KeywordOrIdentifier: {
-                if (token->is_keyword()) {
-                    const auto result = this->compile_keyword(token.value());
-                    if (!result.has_value()) {
-                        return std::unexpected(result.error());
-                    }
-                } else {
-                    const auto result =
-                      this->compile_function_call(token.value());
-                    if (!result.has_value()) {
-                        return std::unexpected(result.error());
-                    }
-                }
-                break;
-            }
-            default: {
-                ++this->m_cursor;
-                this->error(
-                  fmt::format(
-                    "{} is not allowed in this context", token->type_to_string()
-                  ),
-                  token->span()
-                );
+auto ElfAssembler_x86_64::qualified_name(const std::string& name) const
+  -> std::string {
+    return this->m_scope + name;
+}
+
+void ElfAssembler_x86_64::resolve_fixups() {
+    // Symbols defined in another object, created on first use
+    std::unordered_map<std::string, std::uint32_t> external;
+
+    for (const auto& [section, fixup] : this->m_fixups) {
+        const auto label = this->m_labels.find(fixup.symbol);
+
+        // Relative references inside a function are known now, no need for
+        // the linker
+        if (label != this->m_labels.end() && label->second.section == section
+            && fixup.kind == x86::FixupKind::Relative32) {
+            auto&      code  = this->m_object.data(section);
+            const auto value = static_cast<std::int64_t>(label->second.offset)
+                               + fixup.addend
+                               - static_cast<std::int64_t>(fixup.offset);
+            auto bits = static_cast<std::uint32_t>(value);
+            for (std::size_t byte = 0; byte < 4; ++byte) {
+                code[fixup.offset + byte] = static_cast<std::uint8_t>(bits);
+                bits >>= 8U;
             }
+            continue;
+        }
+
+        const std::uint32_t type = fixup.kind == x86::FixupKind::Relative32
+                                     ? R_X86_64_PC32
+                                     : R_X86_64_32S;
+
+        if (label != this->m_labels.end()) {
+            this->m_object.add_relocation(
+              section,
+              elf::Relocation{
+                .offset = fixup.offset,
+                .type   = type,
+                .symbol = this->m_object.section_symbol(label->second.section),
+                .addend = fixup.addend
+                          + static_cast<std::int64_t>(label->second.offset),
+              }
+            );
+            continue;
         }
 
-        token = this->peek();
+        auto [symbol, inserted] = external.try_emplace(fixup.symbol, 0);
+        if (inserted) {
+            symbol->second = this->m_object.add_symbol(elf::Symbol{
+              .name    = fixup.symbol,
+              .binding = elf::SymbolBinding::Global,
+            });
+        }
+        this->m_object.add_relocation(
+          section,
+          elf::Relocation{
+            .offset = fixup.offset,
+            .type   = type,
+            .symbol = symbol->second,
+            .addend = fixup.addend,
+          }
+        );
     }
+}
 
-    return {};
+auto BytecodeAssembler::assemble(const ir::Module& module)
+  -> std::expected<bytecode::Program, AssembleError> {
+    BytecodeAssembler assembler;
+
+    const auto result = assembler.compile_to_assembly(module);
+    if (!result.has_value()) { return std::unexpected(result.error()); }
+
+    return std::move(assembler.m_program);
 }
 
-// FIXME: This currently assumes it cannot fail, but maybe it can (?)
-void Assembler_x86_64::compile_double_quoted_string(const Token& token) {
-    this->m_strings.push_back(token.lexeme());
+BytecodeAssembler::BytecodeAssembler() : Assembler("") {}
 
-    const auto string_size = [&]() -> std::size_t {
-        std::size_t occurrences = 0;
-        std::size_t start       = 0;
-        while ((start = token.lexeme().find("\\n", start)) != std::string::npos
-        ) {
-            ++occurrences;
-            start += 2;
-        }
-        return token.lexeme().size() - occurrences;
-    }();
+void BytecodeAssembler::generate_assembly_prelude() {
+    // print and puts are opcodes, the VM implements them
+}
 
-    this->writeln(fmt::format("\tmov rax, {}", std::to_string(string_size)));
-    this->writeln("\tpush rax");
-    this->writeln(
-      fmt::format("\tpush str_{}", std::to_string(this->m_strings.size() - 1))
-    );
-    ++this->m_cursor;
+void BytecodeAssembler::generate_assembly_header() {}
+
+void BytecodeAssembler::generate_function_begin(const std::string_view name) {
+    if (name == "main") { this->m_program.entry = this->m_program.code.size(); }
 }
 
-auto Assembler_x86_64::compile_keyword([[maybe_unused]] const Token& token)
-  -> std::expected<void, AssembleError> {
-    fmt::print(
-      stderr, "[INTERNAL ERROR] compile_keyword(): is not implemented yet\n"
+void BytecodeAssembler::generate_function_end() {
+    this->emit(bytecode::Opcode::Return);
+}
+
+void BytecodeAssembler::generate_constant(const std::int64_t value) {
+    this->emit(
+      bytecode::Opcode::PushInteger, static_cast<std::uint64_t>(value)
     );
-    ++this->m_cursor;
-    return {};
 }
 
-auto Assembler_x86_64::compile_function_call(const Token& token)
-  -> std::expected<void, AssembleError> {
-    if (token.lexeme() == "print") {
-        this->writeln("\tpop rdi");
-        this->writeln("\tcall print");
-    } else if (token.lexeme() == "puts") {
-        this->writeln("\tpop r9");
-        this->writeln("\tpop r8");
-        this->writeln("\tcall puts");
-    } else {
-        this->error(
-          fmt::format("undeclared function {}", token.lexeme()), token.span()
-        );
-        return std::unexpected(AssembleError::UndeclaredFunction);
+void BytecodeAssembler::generate_string(const std::size_t index) {
+    this->emit(bytecode::Opcode::PushString, this->m_strings.offsets[index]);
+}
+
+void BytecodeAssembler::generate_arithmetic(const ir::Opcode opcode) {
+    switch (opcode) {
+        case ir::Opcode::Add: {
+            this->emit(bytecode::Opcode::Add);
+            break;
+        }
+        case ir::Opcode::Sub: {
+            this->emit(bytecode::Opcode::Sub);
+            break;
+        }
+        default: {
+            this->emit(bytecode::Opcode::Mul);
+            break;
+        }
     }
+}
 
-    ++this->m_cursor;
-    return {};
+void BytecodeAssembler::generate_builtin_call(const Builtin builtin) {
+    static_assert(
+      std::to_underlying(Builtin::Max) == 3,
+      "[INTERNAL ERROR] BytecodeAssembler::generate_builtin_call() requires to "
+      "handle all builtins"
+    );
+
+    switch (builtin) {
+        case Builtin::Print: {
+            this->emit(bytecode::Opcode::Print);
+            break;
+        }
+        case Builtin::Puts: {
+            this->emit(bytecode::Opcode::Puts);
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+void BytecodeAssembler::generate_assembly_start_label() {
+    // The VM starts at Program::entry, recorded along with main
+}
+
+void BytecodeAssembler::generate_data_section() {
+    this->m_program.strings = this->m_strings.bytes;
+}
+
+void BytecodeAssembler::emit(const bytecode::Opcode opcode) {
+    this->m_program.code.push_back(std::to_underlying(opcode));
+}
+
+void BytecodeAssembler::emit(
+  const bytecode::Opcode opcode,
+  const std::uint64_t    operand
+) {
+    this->emit(opcode);
+
+    auto bits = operand;
+    for (std::size_t byte = 0; byte < bytecode::operand_size(opcode);
+         ++byte) {
+        this->m_program.code.push_back(static_cast<std::uint8_t>(bits));
+        bits >>= 8U;
+    }
 }
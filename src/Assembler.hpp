@@ -1,95 +1,318 @@
 #ifndef ASSEMBLER_HPP
 #define ASSEMBLER_HPP
 
+#include "Bytecode.hpp"
 #include "Compiler.hpp"
-#include "Error.hpp"
-#include "Lexer.hpp"
+#include "Elf.hpp"
+#include "Ir.hpp"
+#include "Peephole.hpp"
+#include "StringPool.hpp"
+#include "X86.hpp"
+#include <array>
+#include <charconv>
+#include <cstdlib>
 #include <expected>
 #include <filesystem>
 #include <fmt/format.h>
 #include <fstream>
+#include <iterator>
 #include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 enum class AssembleError {
-    Eof = 0,
-    NoSuchFileOrDirectory,
-    MissingFunctionName,
-    MissingFunctionParametersOrReturnType,
-    NoBeginToken,
-    NoEndToken,
-    UndeclaredFunction,
+    NoSuchFileOrDirectory = 0,
+    ObjectWriteFailure,
+    LinkFailure,
     Max,
 };
 
+/// Walks the ir::Module and drives code generation: the backends only
+/// implement the generate_*() hooks, called for every instruction.
+///
+/// The generated code is a stack machine, values are pushed where they are
+/// defined and popped by the instruction using them, which the IR keeps in
+/// stack order.
 class Assembler {
   public:
-    virtual ~Assembler()                                = default;
+    virtual ~Assembler();
     Assembler(const Assembler& other)                   = delete;
     Assembler(Assembler&& other)                        = default;
     Assembler& operator=(const Assembler& rhs) noexcept = delete;
     Assembler& operator=(Assembler&& rhs) noexcept      = default;
 
-    virtual std::expected<void, AssembleError> compile_to_assembly()       = 0;
-    virtual void                               generate_assembly_prelude() = 0;
+    virtual std::expected<void, AssembleError>
+      compile_to_assembly(const ir::Module& module);
+    virtual void generate_assembly_prelude() = 0;
 
   protected:
+    /// An empty output_filename disables the textual output, writeln() is
+    /// then a no-op
     explicit Assembler(const std::string& output_filename);
 
-    void writeln(const std::string_view str);
+    virtual void generate_assembly_header() = 0;
+    virtual void generate_function_begin(const std::string_view name) = 0;
+    virtual void generate_function_end() = 0;
+    /// Pushes `value`
+    virtual void generate_constant(const std::int64_t value) = 0;
+    /// Pushes the address of the module's string `index`, see m_strings
+    virtual void generate_string(const std::size_t index) = 0;
+    /// Pops the right hand side then the left one, pushes the result of the
+    /// ir::is_arithmetic() `opcode`
+    virtual void generate_arithmetic(const ir::Opcode opcode) = 0;
+    virtual void generate_builtin_call(const Builtin builtin) = 0;
+    virtual void generate_assembly_start_label() = 0;
+    virtual void generate_data_section() = 0;
+
+    /// Formats one line of assembly straight into the output buffer, which
+    /// goes to the file in large writes once it grows past flush_threshold
+    template<typename... Args>
+    void writeln(fmt::format_string<Args...> format, Args&&... args) {
+        if (this->m_output_file == nullptr) { return; }
+
+        fmt::format_to(
+          std::back_inserter(this->m_output),
+          format,
+          std::forward<Args>(args)...
+        );
+        this->m_output.push_back('\n');
+
+        if (this->m_output.size() >= Assembler::flush_threshold) {
+            this->flush();
+        }
+    }
+
+    void flush();
+
+    static constexpr std::size_t flush_threshold = 1UL << 20U;
 
     std::unique_ptr<std::ofstream> m_output_file;
-    std::vector<std::string>       m_strings;
+    fmt::memory_buffer             m_output;
+    StringPool::Layout             m_strings;
+
+  private:
+    void compile_function(const ir::Function& function);
+};
+
+/// How the runtime library (src/Runtime.s) writes to stdout: `puts` and
+/// `print` append to a buffer in .bss, written out when full and before
+/// exiting. Every program carries its own settings and buffer, see
+/// Assembler_x86_64::generate_data_section().
+struct OutputBuffering {
+    // 0 issues a write syscall on every call instead
+    std::size_t size             = 1UL << 16U;
+    // Also write out every line as it ends, when stdout is a terminal
+    bool        flush_on_newline = false;
+
+    // print writes straight into the buffer, which has to fit its longest
+    // output: a sign, 19 digits and a newline
+    static constexpr std::size_t min_size = 21;
+    // Keeps the buffer well within reach of RIP-relative addressing
+    static constexpr std::size_t max_size = 1UL << 30U;
 };
 
 class Assembler_x86_64 : public Assembler {
   public:
     // TODO: Add custom output file name
+    /// `peephole_stats` is added what the peephole optimizer did
     [[nodiscard]] static auto compile(
       const std::shared_ptr<Compiler>& compiler,
-      const std::vector<Token>&        tokens
+      const ir::Module&                module,
+      const OutputBuffering&           buffering,
+      x86::PeepholeStats&              peephole_stats
     ) -> std::expected<void, AssembleError>;
 
-  private:
+  protected:
     Assembler_x86_64(
+      const std::string&     output_filename,
+      const OutputBuffering& buffering
+    );
+
+    void generate_assembly_prelude() override;
+    void generate_assembly_header() override;
+    void generate_function_begin(const std::string_view name) override;
+    void generate_function_end() override;
+    void generate_constant(const std::int64_t value) override;
+    void generate_string(const std::size_t index) override;
+    void generate_arithmetic(const ir::Opcode opcode) override;
+    void generate_builtin_call(const Builtin builtin) override;
+    void generate_assembly_start_label() override;
+    void generate_data_section() override;
+
+    /// Buffered in m_listing, until write_listing()
+    void emit(const x86::Instruction& instruction);
+    void emit_label(const std::string& name, const bool global = false);
+
+    /// Runs the peephole optimizer over m_listing and writes it out, called
+    /// at the end of every function
+    void write_listing();
+
+    /// Every instruction and label left after the peephole optimizer goes
+    /// through these, so a backend only has to override them to produce
+    /// something else than NASM source
+    virtual void write_instruction(const x86::Instruction& instruction);
+    virtual void write_label(const std::string& name, const bool global);
+
+    x86::PeepholeStats m_peephole_stats{};
+    OutputBuffering    m_buffering;
+
+  private:
+    // Large functions are optimized in windows of this many entries, the
+    // listing of a whole function could take more memory than its source
+    static constexpr std::size_t max_listing = 4096;
+
+    // Where computed values live: caller-saved, and not taken by the
+    // builtins' arguments (rdi, r8, r9)
+    static constexpr std::array<x86::Register, 6> scratch_registers = {
+        x86::Register::Rax, x86::Register::Rcx, x86::Register::Rdx,
+        x86::Register::Rsi, x86::Register::R10, x86::Register::R11,
+    };
+
+    /// Pops the top of the program's stack into `reg`
+    void pop_into(const x86::Register reg);
+
+    /// Pops the top of the program's stack as an instruction operand, only
+    /// values spilled to the machine stack are loaded into a register
+    [[nodiscard]] auto pop_operand() -> x86::Operand;
+
+    /// `value` in a register: itself, or a newly allocated one it is loaded
+    /// into
+    [[nodiscard]] auto to_register(const x86::Operand& value)
+      -> x86::Register;
+
+    /// `reg` *= `value`, with shifts and lea where possible
+    void multiply(const x86::Register reg, const std::int64_t value);
+
+    /// Takes a free scratch register, spilling the oldest value held in one
+    /// if there is none left
+    [[nodiscard]] auto allocate_register() -> x86::Register;
+    void               release_register(const x86::Register reg);
+
+    /// Pushes the values held in registers to the machine stack, oldest
+    /// first, up to `count` of them
+    void spill(const std::size_t count);
+
+    // The program's stack, top last. Values are only materialized when
+    // popped, straight into the register they are used in: constants as
+    // immediates, strings as RIP-relative addresses. Computed values are
+    // held in a scratch register, or spilled to the machine stack
+    // (std::monostate) before calls and when running out of registers.
+    // Spilled values are always below the ones in registers, so the machine
+    // stack pops them in order.
+    std::vector<x86::Operand>  m_stack;
+    // No value of m_stack below this index is in a register
+    std::size_t                m_first_register = 0;
+    std::vector<x86::Register> m_free_registers;
+    x86::Listing               m_listing;
+};
+
+/// Encodes the instructions generated by Assembler_x86_64 straight into a
+/// relocatable ELF64 object, without going through an external assembler,
+/// or links it right away with the runtime library into the final
+/// executable. The NASM source is still written alongside when asked for.
+class ElfAssembler_x86_64 final : public Assembler_x86_64 {
+  public:
+    enum class Output : std::uint8_t {
+        // `<output>.o`, for an external linker
+        Object = 0,
+        // `<output>` itself, ready to run
+        Executable,
+        // Nothing written, see assemble(). The output buffer is left out,
+        // the host provides `print` and `puts` (buffered by stdio).
+        Module,
+    };
+
+    /// `runtime_library` is the archive an Output::Executable is linked
+    /// with
+    [[nodiscard]] static auto compile(
       const std::shared_ptr<Compiler>& compiler,
-      const std::vector<Token>&        tokens,
-      const std::string&               output_filename
+      const ir::Module&                module,
+      const bool                       keep_assembly,
+      const Output                     output,
+      const OutputBuffering&           buffering,
+      const std::string&               runtime_library,
+      x86::PeepholeStats&              peephole_stats
+    ) -> std::expected<void, AssembleError>;
+
+    /// Generates the program as an Output::Module object, for the JIT
+    [[nodiscard]] static auto assemble(const ir::Module& module)
+      -> std::expected<elf::ObjectFile, AssembleError>;
+
+  private:
+    ElfAssembler_x86_64(
+      const std::string&     assembly_filename,
+      std::string            output_filename,
+      const Output           output,
+      const OutputBuffering& buffering,
+      std::string            runtime_library
     );
 
-    auto compile_to_assembly() -> std::expected<void, AssembleError> final;
-    void generate_assembly_prelude() final;
+    auto compile_to_assembly(const ir::Module& module)
+      -> std::expected<void, AssembleError> final;
+
+    void write_instruction(const x86::Instruction& instruction) final;
+    void write_label(const std::string& name, const bool global) final;
+    void generate_data_section() final;
 
-    void generate_assembly_header();
-    void generate_assembly_start_label();
-    void generate_data_section();
+    /// NASM scoping: labels starting with '.' belong to the last global one
+    [[nodiscard]] auto qualified_name(const std::string& name) const
+      -> std::string;
 
-    [[nodiscard]] auto
-      span(const std::size_t start, const std::size_t end) const -> Span;
+    void resolve_fixups();
+    [[nodiscard]] auto write_output() -> std::expected<void, AssembleError>;
 
-    void error(const std::string& message, const Span& span);
+    struct Location {
+        std::uint32_t section;
+        std::uint64_t offset;
+    };
 
-    [[nodiscard]] auto eof() const -> bool;
-    [[nodiscard]] auto peek() const -> std::expected<Token, AssembleError>;
-    [[nodiscard]] auto peek_ahead(const std::size_t offset) const
-      -> std::expected<Token, AssembleError>;
-    [[nodiscard]] auto next() -> std::expected<void, AssembleError>;
+    /// Label reference in the code of `section`
+    struct SectionFixup {
+        std::uint32_t section;
+        x86::Fixup    fixup;
+    };
 
-    [[nodiscard]] auto find_nearest_end() const
-      -> std::expected<std::size_t, AssembleError>;
+    std::string                               m_output_filename;
+    Output                                    m_output_kind;
+    std::string                               m_runtime_library;
+    elf::ObjectFile                           m_object;
+    // Section of the function being written, see write_label()
+    std::uint32_t                             m_text = 0;
+    std::uint32_t                             m_rodata;
+    // Fixups of the instruction being encoded
+    std::vector<x86::Fixup>                   m_encoded;
+    std::vector<SectionFixup>                 m_fixups;
+    std::unordered_map<std::string, Location> m_labels;
+    std::string                               m_scope;
+};
 
-    [[nodiscard]] auto compile_function() -> std::expected<void, AssembleError>;
-    [[nodiscard]] auto compile_function_body()
-      -> std::expected<void, AssembleError>;
-    void               compile_double_quoted_string(const Token& token);
-    [[nodiscard]] auto compile_keyword(const Token& token)
-      -> std::expected<void, AssembleError>;
-    [[nodiscard]] auto compile_function_call(const Token& token)
-      -> std::expected<void, AssembleError>;
+/// Compiles the program to bytecode::Program, for vm::Vm
+class BytecodeAssembler final : public Assembler {
+  public:
+    [[nodiscard]] static auto assemble(const ir::Module& module)
+      -> std::expected<bytecode::Program, AssembleError>;
 
-    std::shared_ptr<Compiler> m_compiler;
-    std::vector<Token>        m_tokens;
-    std::size_t               m_cursor = 0;
+  private:
+    BytecodeAssembler();
+
+    void generate_assembly_prelude() final;
+    void generate_assembly_header() final;
+    void generate_function_begin(const std::string_view name) final;
+    void generate_function_end() final;
+    void generate_constant(const std::int64_t value) final;
+    void generate_string(const std::size_t index) final;
+    void generate_arithmetic(const ir::Opcode opcode) final;
+    void generate_builtin_call(const Builtin builtin) final;
+    void generate_assembly_start_label() final;
+    void generate_data_section() final;
+
+    void emit(const bytecode::Opcode opcode);
+    void emit(const bytecode::Opcode opcode, const std::uint64_t operand);
+
+    bytecode::Program m_program;
 };
 
 // {fmt} - Custom Formatters
@@ -103,7 +326,7 @@ struct fmt::formatter<AssembleError> {
     template<typename FormatContext>
     auto format(const AssembleError& error, FormatContext& ctx) {
         static_assert(
-          std::to_underlying(AssembleError::Max) == 7,
+          std::to_underlying(AssembleError::Max) == 3,
           "[INTERNAL ERROR] fmt::formatter<AssembleError> requires to handle "
           "all "
           "enum variants"
@@ -111,27 +334,14 @@ struct fmt::formatter<AssembleError> {
 
         const auto enum_to_str = [](const AssembleError& error) {
             switch (error) {
-                case AssembleError::Eof: {
-                    return "AssembleError::Eof";
-                }
                 case AssembleError::NoSuchFileOrDirectory: {
                     return "AssembleError::NoSuchFileOrDirectory";
                 }
-                case AssembleError::MissingFunctionName: {
-                    return "AssembleError::MissingFunctionName";
-                }
-                case AssembleError::MissingFunctionParametersOrReturnType: {
-                    return "AssembleError::"
-                           "MissingFunctionParametersOrReturnType";
-                }
-                case AssembleError::NoBeginToken: {
-                    return "AssembleError::NoBeginToken";
-                }
-                case AssembleError::NoEndToken: {
-                    return "AssembleError::NoEndToken";
+                case AssembleError::ObjectWriteFailure: {
+                    return "AssembleError::ObjectWriteFailure";
                 }
-                case AssembleError::UndeclaredFunction: {
-                    return "AssembleError::UndeclaredFunction";
+                case AssembleError::LinkFailure: {
+                    return "AssembleError::LinkFailure";
                 }
                 default: {
                     return "Unknown Assemble Error";
@@ -0,0 +1,56 @@
+#ifndef AST_HPP
+#define AST_HPP
+
+#include "Lexer.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// Syntax tree built by Parser and walked by the Assembler backends.
+///
+/// Statements are stored in the compilation's Arena (see Compiler::arena()),
+/// a Program is only valid as long as the Compiler it was parsed with.
+namespace ast {
+
+enum class StatementKind : std::uint8_t {
+    // Pushes the string, see Token::lexeme()
+    StringLiteral = 0,
+    // Pushes the number, see Token::value()
+    NumberLiteral,
+    // Builtin call, see Token::builtin()
+    Call,
+    // Pops two values and pushes the result: `+`, `-` or `*`, see
+    // Token::type()
+    Arithmetic,
+    // Keyword other than begin/end, not compiled yet
+    Keyword,
+    // begin ... end, `token` is the begin
+    Block,
+    Max
+};
+
+struct Statement {
+    StatementKind       kind;
+    Token               token;
+    // Block only: the nested statements
+    const Statement*    children       = nullptr;
+    std::uint32_t       children_count = 0;
+
+    [[nodiscard]] auto body() const -> std::span<const Statement> {
+        return { this->children, this->children_count };
+    }
+};
+
+struct Function {
+    Token                      name;
+    Token                      return_type;
+    std::span<const Statement> body;
+};
+
+struct Program {
+    std::vector<Function> functions;
+};
+
+} // namespace ast
+
+#endif // AST_HPP
@@ -0,0 +1,68 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Stack machine instruction set mirroring the RPN language one to one,
+/// generated by BytecodeAssembler and executed by vm::Vm.
+///
+/// Every instruction is a one byte opcode followed by its operands, stored
+/// little-endian.
+namespace bytecode {
+
+enum class Opcode : std::uint8_t {
+    // u64 operand: pushes it
+    PushInteger = 0,
+    // u32 offset in Program::strings: pushes the address there
+    PushString,
+    // Pop the right hand side then the left one, push the result, wrapping
+    // around on overflow
+    Add,
+    Sub,
+    Mul,
+    // Pops a value, writes it in decimal followed by a newline
+    Print,
+    // Pops an address then a size, writes those bytes
+    Puts,
+    // Leaves the current function
+    Return,
+    Max
+};
+
+/// Bytes of operands following the opcode
+[[nodiscard]] constexpr auto operand_size(const Opcode opcode) -> std::size_t {
+    static_assert(
+      std::to_underlying(Opcode::Max) == 8,
+      "[INTERNAL ERROR] bytecode::operand_size() requires to handle all "
+      "opcodes"
+    );
+
+    switch (opcode) {
+        case Opcode::PushInteger: {
+            return sizeof(std::uint64_t);
+        }
+        case Opcode::PushString: {
+            return sizeof(std::uint32_t);
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+struct Program {
+    std::vector<std::uint8_t>  code;
+    // Every string back to back, like in .rodata, see StringPool::Layout
+    std::string                strings;
+    // Offset of `main` in the code, if the program has one
+    std::optional<std::size_t> entry;
+};
+
+} // namespace bytecode
+
+#endif // BYTECODE_HPP
@@ -2,33 +2,72 @@
 
 auto Compiler::create(const std::string& target, const std::string& output)
   -> std::shared_ptr<Compiler> {
-    return std::make_shared<Compiler>(Compiler(target, output));
+    // Not movable, it owns a mutex
+    return std::shared_ptr<Compiler>(new Compiler(target, output));
 }
 
 Compiler::Compiler(std::string target, std::string output)
   : m_target{ std::move(target) },
+    m_file_id{ this->m_files.intern(this->m_target) },
     m_errors{ {} },
     m_output{ std::move(output) } {}
 
 auto Compiler::target() const -> std::string { return this->m_target; }
 
+auto Compiler::file_id() const -> std::uint32_t { return this->m_file_id; }
+
+auto Compiler::files() const -> const FileTable& { return this->m_files; }
+
 auto Compiler::errors() const -> std::vector<RackError> {
     return this->m_errors;
 }
 
 auto Compiler::has_errors() const -> bool { return !this->m_errors.empty(); }
 
-auto Compiler::file_contents() const -> std::string {
-    if (this->m_file_contents.empty()) {
-        const auto contents = dts::read_file<std::string>(this->m_target);
-        if (!contents.has_value()) {
+auto Compiler::arena() -> Arena& { return this->m_arena; }
+
+auto Compiler::add_number(const std::uint64_t value) -> std::size_t {
+    const std::scoped_lock lock(this->m_numbers_mutex);
+    this->m_numbers.push_back(value);
+    return this->m_numbers.size() - 1;
+}
+
+auto Compiler::number(const std::size_t slot) const -> std::uint64_t {
+    return this->m_numbers[slot];
+}
+
+auto Compiler::file_contents() const -> std::string_view {
+    if (!this->m_source.has_value()) {
+        auto source = dts::map_file(this->m_target);
+        if (!source.has_value()) {
             fmt::print(stderr, fmt::fg(fmt::color::red), "error");
-            fmt::print(stderr, fmt::emphasis::bold, ": empty file\n");
+            fmt::print(
+              stderr,
+              fmt::emphasis::bold,
+              ": {}: {}\n",
+              this->m_target,
+              dts::filesystem_error(source.error())
+            );
+            source = dts::MappedFile{};
         }
-        this->m_file_contents = contents.value();
+
+        // Spans store 32-bit offsets
+        if (source->size() > std::numeric_limits<std::uint32_t>::max()) {
+            fmt::print(stderr, fmt::fg(fmt::color::red), "error");
+            fmt::print(
+              stderr,
+              fmt::emphasis::bold,
+              ": {}: source files larger than 4GiB are not supported\n",
+              this->m_target
+            );
+            source = dts::MappedFile{};
+        }
+
+        this->m_source = std::move(source.value());
+        this->m_files.set_contents(this->m_file_id, this->m_source->view());
     }
 
-    return this->m_file_contents;
+    return this->m_source->view();
 }
 
 auto Compiler::output() const -> std::string { return this->m_output; }
@@ -38,9 +77,10 @@ void Compiler::push_error(const RackError& error) {
 }
 
 void Compiler::print_errors() const {
-    for (const auto& error : this->m_errors) {
-        print_error(error, this->file_contents());
-    }
+    // Make sure the source is registered before spans get resolved
+    static_cast<void>(this->file_contents());
+
+    for (const auto& error : this->m_errors) { print_error(*this, error); }
     fmt::print(stderr, fmt::fg(fmt::color::red), "error");
     fmt::print(
       stderr, fmt::emphasis::bold, ": aborting due to previous error(s)\n"
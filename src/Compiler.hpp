@@ -3,10 +3,17 @@
 
 #define FMT_HEADER_ONLY
 
+#include "Arena.hpp"
 #include "Error.hpp"
 #include <fmt/color.h>
+#include <cstdint>
 #include <fmt/format.h>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Compiler {
@@ -16,22 +23,70 @@ class Compiler {
         -> std::shared_ptr<Compiler>;
 
     [[nodiscard]] auto target() const -> std::string;
+    [[nodiscard]] auto file_id() const -> std::uint32_t;
+    /// Paths and contents of the file ids spans and tokens carry
+    [[nodiscard]] auto files() const -> const FileTable&;
     [[nodiscard]] auto errors() const -> std::vector<RackError>;
-    [[nodiscard]] auto file_contents() const -> std::string;
+    [[nodiscard]] auto file_contents() const -> std::string_view;
     [[nodiscard]] auto output() const -> std::string;
 
     [[nodiscard]] auto has_errors() const -> bool;
 
+    /// Keeps a number literal too wide to be stored in its token, returns
+    /// the slot it is in. Safe to call from the lexer's threads.
+    [[nodiscard]] auto add_number(const std::uint64_t value) -> std::size_t;
+    /// Number stored by add_number(), once lexing is done
+    [[nodiscard]] auto number(const std::size_t slot) const -> std::uint64_t;
+
+    /// Storage for the AST, freed along with the Compiler
+    [[nodiscard]] auto arena() -> Arena&;
+
     void push_error(const RackError& error);
     void print_errors() const;
 
   private:
     Compiler(std::string target, std::string output);
 
-    std::string            m_target;
-    std::vector<RackError> m_errors;
-    mutable std::string    m_file_contents;
-    std::string            m_output;
+    std::string                            m_target;
+    // Mutable like m_source, which registers its contents here
+    mutable FileTable                      m_files;
+    std::uint32_t                          m_file_id;
+    std::vector<RackError>                 m_errors;
+    // Single immutable copy of the source, every token is a view into it.
+    // Mapped on first use and kept alive for the whole compilation.
+    mutable std::optional<dts::MappedFile> m_source;
+    std::string                            m_output;
+    Arena                                  m_arena;
+    std::mutex                             m_numbers_mutex;
+    std::vector<std::uint64_t>             m_numbers;
+};
+
+/// A Span or a Token along with the Compiler owning its file id, which
+/// {fmt} needs to print the path or the lexeme
+template<typename T>
+struct Located {
+    const Compiler& compiler;
+    T               value;
+};
+
+// {fmt} Custom Formatters
+template<>
+struct fmt::formatter<Located<Span>> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const Located<Span>& span, FormatContext& ctx) {
+        return fmt::format_to(
+          ctx.out(),
+          "Span {{ file_id: {}, start: {}, end: {} }}",
+          span.compiler.files().path(span.value.file_id()),
+          span.value.start(),
+          span.value.end()
+        );
+    }
 };
 
 #endif // COMPILER_HPP
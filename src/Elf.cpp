@@ -0,0 +1,1045 @@
+#include "Elf.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+[[nodiscard]] constexpr auto
+  align_up(const std::uint64_t value, const std::uint64_t alignment)
+    -> std::uint64_t {
+    return alignment <= 1 ? value : (value + alignment - 1) & ~(alignment - 1);
+}
+
+/// Appends raw structures and strings to the output image
+class Image {
+  public:
+    template<typename T>
+    void write(const T& value) {
+        const auto* bytes = reinterpret_cast<const std::uint8_t*>(&value);
+        this->m_bytes.insert(this->m_bytes.end(), bytes, bytes + sizeof(T));
+    }
+
+    void write(const std::vector<std::uint8_t>& bytes) {
+        this->m_bytes.insert(this->m_bytes.end(), bytes.begin(), bytes.end());
+    }
+
+    void align(const std::uint64_t alignment) {
+        this->m_bytes.resize(align_up(this->m_bytes.size(), alignment), 0);
+    }
+
+    [[nodiscard]] auto size() const -> std::uint64_t {
+        return this->m_bytes.size();
+    }
+
+    [[nodiscard]] auto take() -> std::vector<std::uint8_t> {
+        return std::move(this->m_bytes);
+    }
+
+  private:
+    std::vector<std::uint8_t> m_bytes;
+};
+
+/// String table builder, offset 0 is the empty string
+class StringTable {
+  public:
+    StringTable() : m_bytes{ 0 } {}
+
+    [[nodiscard]] auto add(const std::string_view str) -> std::uint32_t {
+        if (str.empty()) { return 0; }
+        const auto offset = static_cast<std::uint32_t>(this->m_bytes.size());
+        this->m_bytes.insert(this->m_bytes.end(), str.begin(), str.end());
+        this->m_bytes.push_back(0);
+        return offset;
+    }
+
+    [[nodiscard]] auto bytes() const -> const std::vector<std::uint8_t>& {
+        return this->m_bytes;
+    }
+
+  private:
+    std::vector<std::uint8_t> m_bytes;
+};
+
+// Where executables are loaded, the usual default of GNU ld
+constexpr std::uint64_t base_address = 0x400000;
+constexpr std::uint64_t page_size    = 0x1000;
+
+/// Stores `value` little-endian in `size` bytes of `bytes` at `offset`
+void patch(
+  std::vector<std::uint8_t>& bytes,
+  const std::uint64_t        offset,
+  const std::uint64_t        value,
+  const std::size_t          size
+) {
+    auto bits = value;
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        bytes[offset + idx] = static_cast<std::uint8_t>(bits);
+        bits >>= 8U;
+    }
+}
+
+[[nodiscard]] constexpr auto fits_i32(const std::int64_t value) -> bool {
+    return value >= std::numeric_limits<std::int32_t>::min()
+           && value <= std::numeric_limits<std::int32_t>::max();
+}
+
+/// A `T` copied out of `bytes` at `offset`, nullopt past the end
+template<typename T>
+[[nodiscard]] auto read_at(
+  const std::span<const std::uint8_t> bytes,
+  const std::uint64_t                 offset
+) -> std::optional<T> {
+    if (offset > bytes.size() || bytes.size() - offset < sizeof(T)) {
+        return std::nullopt;
+    }
+    T value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(T));
+    return value;
+}
+
+/// What `header` holds in the file, nullopt past the end
+[[nodiscard]] auto section_bytes(
+  const std::span<const std::uint8_t> bytes,
+  const Elf64_Shdr&                   header
+) -> std::optional<std::span<const std::uint8_t>> {
+    if (header.sh_type == SHT_NOBITS) {
+        return std::span<const std::uint8_t>{};
+    }
+    if (header.sh_offset > bytes.size()
+        || bytes.size() - header.sh_offset < header.sh_size) {
+        return std::nullopt;
+    }
+    return bytes.subspan(header.sh_offset, header.sh_size);
+}
+
+/// The NUL-terminated string at `offset` of a string table
+[[nodiscard]] auto string_at(
+  const std::span<const std::uint8_t> table,
+  const std::uint64_t                 offset
+) -> std::optional<std::string_view> {
+    const std::string_view strings(
+      reinterpret_cast<const char*>(table.data()), table.size()
+    );
+    if (offset >= strings.size()) { return std::nullopt; }
+
+    const auto end = strings.find('\0', offset);
+    if (end == std::string_view::npos) { return std::nullopt; }
+    return strings.substr(offset, end - offset);
+}
+
+} // namespace
+
+namespace elf {
+
+auto ObjectFile::read(const std::span<const std::uint8_t> bytes)
+  -> std::expected<ObjectFile, LinkError> {
+    const auto invalid = std::unexpected(LinkError::InvalidInput);
+
+    const auto header = read_at<Elf64_Ehdr>(bytes, 0);
+    if (!header.has_value()
+        || std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0
+        || header->e_ident[EI_CLASS] != ELFCLASS64
+        || header->e_ident[EI_DATA] != ELFDATA2LSB
+        || header->e_type != ET_REL || header->e_machine != EM_X86_64) {
+        return invalid;
+    }
+
+    std::vector<Elf64_Shdr> headers;
+    for (std::uint64_t idx = 0; idx < header->e_shnum; ++idx) {
+        const auto section = read_at<Elf64_Shdr>(
+          bytes, header->e_shoff + idx * sizeof(Elf64_Shdr)
+        );
+        if (!section.has_value()) { return invalid; }
+        headers.push_back(section.value());
+    }
+    if (header->e_shstrndx >= headers.size()) { return invalid; }
+    const auto names = section_bytes(bytes, headers[header->e_shstrndx]);
+    if (!names.has_value()) { return invalid; }
+
+    ObjectFile object;
+
+    // Only what gets loaded, notes and debug information are left out
+    std::vector<std::optional<std::uint32_t>> sections(headers.size());
+    for (std::size_t idx = 0; idx < headers.size(); ++idx) {
+        const auto& section = headers[idx];
+        if ((section.sh_flags & SHF_ALLOC) == 0) { continue; }
+        if (section.sh_type != SHT_PROGBITS && section.sh_type != SHT_NOBITS) {
+            return invalid;
+        }
+
+        const auto name     = string_at(names.value(), section.sh_name);
+        const auto contents = section_bytes(bytes, section);
+        if (!name.has_value() || !contents.has_value()) { return invalid; }
+
+        const auto kind = [&]() {
+            if (section.sh_type == SHT_NOBITS) {
+                return SectionKind::Uninitialized;
+            }
+            if ((section.sh_flags & SHF_EXECINSTR) != 0) {
+                return SectionKind::Code;
+            }
+            if ((section.sh_flags & SHF_WRITE) != 0) {
+                return SectionKind::Data;
+            }
+            return SectionKind::ReadOnlyData;
+        }();
+
+        const auto added = object.add_section(
+          std::string(name.value()), kind, section.sh_addralign
+        );
+        sections[idx] = added;
+        if (kind == SectionKind::Uninitialized) {
+            std::ignore = object.reserve(added, section.sh_size);
+        } else {
+            object.data(added).assign(contents->begin(), contents->end());
+        }
+    }
+
+    // Where every symbol of the file ended up, section symbols included
+    std::vector<std::optional<std::uint32_t>> symbols;
+    const auto symtab =
+      std::ranges::find(headers, SHT_SYMTAB, &Elf64_Shdr::sh_type);
+    if (symtab != headers.end()) {
+        const auto table = section_bytes(bytes, *symtab);
+        if (!table.has_value() || symtab->sh_link >= headers.size()) {
+            return invalid;
+        }
+        const auto strings = section_bytes(bytes, headers[symtab->sh_link]);
+        if (!strings.has_value()) { return invalid; }
+
+        symbols.resize(table->size() / sizeof(Elf64_Sym));
+        // Entry 0 is the null symbol
+        for (std::size_t idx = 1; idx < symbols.size(); ++idx) {
+            const auto entry =
+              read_at<Elf64_Sym>(table.value(), idx * sizeof(Elf64_Sym))
+                .value();
+            const auto type    = ELF64_ST_TYPE(entry.st_info);
+            const auto section = entry.st_shndx < sections.size()
+                                   ? sections[entry.st_shndx]
+                                   : std::nullopt;
+
+            if (type == STT_FILE) { continue; }
+            if (type == STT_SECTION) {
+                if (section.has_value()) {
+                    symbols[idx] = object.section_symbol(section.value());
+                }
+                continue;
+            }
+            // Absolute and common symbols are not supported
+            if (entry.st_shndx != SHN_UNDEF && !section.has_value()) {
+                return invalid;
+            }
+
+            const auto name = string_at(strings.value(), entry.st_name);
+            if (!name.has_value()) { return invalid; }
+
+            symbols[idx] = object.add_symbol(Symbol{
+              .name    = std::string(name.value()),
+              .section = section,
+              .value   = entry.st_value,
+              .size    = entry.st_size,
+              .binding = ELF64_ST_BIND(entry.st_info) == STB_LOCAL
+                           ? SymbolBinding::Local
+                           : SymbolBinding::Global,
+              .type    = type == STT_FUNC     ? SymbolType::Function
+                         : type == STT_OBJECT ? SymbolType::Object
+                                              : SymbolType::None,
+            });
+        }
+    }
+
+    for (const auto& section : headers) {
+        if (section.sh_type != SHT_RELA && section.sh_type != SHT_REL) {
+            continue;
+        }
+        // Relocations of a section left out
+        if (section.sh_info >= sections.size()
+            || !sections[section.sh_info].has_value()) {
+            continue;
+        }
+
+        // x86-64 objects only use SHT_RELA
+        const auto table = section_bytes(bytes, section);
+        if (section.sh_type == SHT_REL || !table.has_value()) {
+            return invalid;
+        }
+
+        const auto target = sections[section.sh_info].value();
+        const auto size   = object.data(target).size();
+        for (std::size_t offset = 0;
+             offset + sizeof(Elf64_Rela) <= table->size();
+             offset += sizeof(Elf64_Rela)) {
+            const auto entry =
+              read_at<Elf64_Rela>(table.value(), offset).value();
+            const auto symbol = ELF64_R_SYM(entry.r_info);
+            const auto type   = static_cast<std::uint32_t>(
+              ELF64_R_TYPE(entry.r_info)
+            );
+            const auto width = type == R_X86_64_64 ? 8U : 4U;
+            if (symbol >= symbols.size() || !symbols[symbol].has_value()
+                || entry.r_offset > size || size - entry.r_offset < width) {
+                return invalid;
+            }
+
+            object.add_relocation(
+              target,
+              Relocation{
+                .offset = entry.r_offset,
+                .type   = type,
+                .symbol = symbols[symbol].value(),
+                .addend = entry.r_addend,
+              }
+            );
+        }
+    }
+
+    return object;
+}
+
+auto ObjectFile::read_archive(const std::span<const std::uint8_t> bytes)
+  -> std::expected<std::vector<ObjectFile>, LinkError> {
+    constexpr std::string_view magic = "!<arch>\n";
+    // Every member starts with a text header: name[16], date[12], uid[6],
+    // gid[6], mode[8], size[10] and "`\n"
+    constexpr std::size_t header_size = 60;
+    constexpr std::size_t size_offset = 48;
+    constexpr std::size_t size_length = 10;
+
+    const std::string_view archive(
+      reinterpret_cast<const char*>(bytes.data()), bytes.size()
+    );
+    if (!archive.starts_with(magic)) {
+        return std::unexpected(LinkError::InvalidInput);
+    }
+
+    std::vector<ObjectFile> objects;
+    auto                    offset = magic.size();
+    while (offset < archive.size()) {
+        if (archive.size() - offset < header_size
+            || archive.substr(offset + header_size - 2, 2) != "`\n") {
+            return std::unexpected(LinkError::InvalidInput);
+        }
+
+        const auto name = archive.substr(offset, 16);
+        const auto digits =
+          archive.substr(offset + size_offset, size_length);
+        std::uint64_t size   = 0;
+        const auto    parsed =
+          std::from_chars(digits.data(), digits.data() + digits.size(), size);
+        offset += header_size;
+        if (parsed.ec != std::errc{} || archive.size() - offset < size) {
+            return std::unexpected(LinkError::InvalidInput);
+        }
+
+        // "/" is the symbol index and "//" the long names "/<offset>" refer
+        // to, neither is an object
+        const auto table =
+          name.starts_with('/')
+          && std::isdigit(static_cast<unsigned char>(name[1])) == 0;
+        if (!table) {
+            auto object = ObjectFile::read(bytes.subspan(offset, size));
+            if (!object.has_value()) {
+                return std::unexpected(object.error());
+            }
+            objects.push_back(std::move(object.value()));
+        }
+
+        // Members are 2-byte aligned
+        offset = align_up(offset + size, 2);
+    }
+
+    return objects;
+}
+
+auto ObjectFile::add_section(
+  std::string         name,
+  const SectionKind   kind,
+  const std::uint64_t alignment
+) -> std::uint32_t {
+    const auto index = static_cast<std::uint32_t>(this->m_sections.size());
+    this->m_sections.push_back(Section{
+      .name      = std::move(name),
+      .kind      = kind,
+      .alignment = alignment,
+    });
+    this->m_sections.back().symbol = this->add_symbol(Symbol{
+      .name    = "",
+      .section = index,
+      .type    = SymbolType::Section,
+    });
+    return index;
+}
+
+auto ObjectFile::add_symbol(Symbol symbol) -> std::uint32_t {
+    this->m_symbols.push_back(std::move(symbol));
+    return static_cast<std::uint32_t>(this->m_symbols.size() - 1);
+}
+
+void ObjectFile::add_relocation(
+  const std::uint32_t section,
+  const Relocation&   relocation
+) {
+    this->m_sections[section].relocations.push_back(relocation);
+}
+
+auto ObjectFile::data(const std::uint32_t section)
+  -> std::vector<std::uint8_t>& {
+    return this->m_sections[section].data;
+}
+
+auto ObjectFile::reserve(const std::uint32_t section, const std::uint64_t size)
+  -> std::uint64_t {
+    auto& target = this->m_sections[section];
+    const auto offset =
+      align_up(target.uninitialized_size, target.alignment);
+    target.uninitialized_size = offset + size;
+    return offset;
+}
+
+auto ObjectFile::section_symbol(const std::uint32_t section) const
+  -> std::uint32_t {
+    return this->m_sections[section].symbol;
+}
+
+auto ObjectFile::defines(const std::string_view name) const -> bool {
+    return this->find_symbol(name).has_value();
+}
+
+auto ObjectFile::undefined_symbols() const -> std::vector<std::string> {
+    const auto globals = this->global_symbols();
+
+    std::vector<std::string> undefined;
+    for (const auto& symbol : this->m_symbols) {
+        if (symbol.section.has_value() || globals.contains(symbol.name)
+            || std::ranges::find(undefined, symbol.name) != undefined.end()) {
+            continue;
+        }
+        undefined.push_back(symbol.name);
+    }
+    return undefined;
+}
+
+void ObjectFile::append(const ObjectFile& other) {
+    const auto section_base =
+      static_cast<std::uint32_t>(this->m_sections.size());
+    const auto symbol_base = static_cast<std::uint32_t>(this->m_symbols.size());
+
+    for (auto symbol : other.m_symbols) {
+        if (symbol.section.has_value()) {
+            symbol.section = symbol.section.value() + section_base;
+        }
+        this->m_symbols.push_back(std::move(symbol));
+    }
+    for (auto section : other.m_sections) {
+        section.symbol += symbol_base;
+        for (auto& relocation : section.relocations) {
+            relocation.symbol += symbol_base;
+        }
+        this->m_sections.push_back(std::move(section));
+    }
+}
+
+auto ObjectFile::serialize() const -> std::vector<std::uint8_t> {
+    // Section header indices: null, our sections, one .rela per section with
+    // relocations, then .symtab, .strtab, .shstrtab and .note.GNU-stack
+    const auto section_index = [](const std::size_t section) {
+        return static_cast<std::uint16_t>(section + 1);
+    };
+
+    std::vector<std::size_t> relocated;
+    for (std::size_t idx = 0; idx < this->m_sections.size(); ++idx) {
+        if (!this->m_sections[idx].relocations.empty()) {
+            relocated.push_back(idx);
+        }
+    }
+    const auto symtab_index = static_cast<std::uint32_t>(
+      1 + this->m_sections.size() + relocated.size()
+    );
+    const auto strtab_index   = symtab_index + 1;
+    const auto shstrtab_index = symtab_index + 2;
+    const auto note_index     = symtab_index + 3;
+    const auto section_count  = note_index + 1;
+
+    // Locals must precede globals, keep the relative order otherwise
+    std::vector<std::uint32_t> final_index(this->m_symbols.size());
+    std::vector<std::size_t>   order;
+    order.reserve(this->m_symbols.size());
+    for (const auto binding : { SymbolBinding::Local, SymbolBinding::Global }) {
+        for (std::size_t idx = 0; idx < this->m_symbols.size(); ++idx) {
+            if (this->m_symbols[idx].binding == binding) {
+                final_index[idx] = static_cast<std::uint32_t>(order.size() + 1);
+                order.push_back(idx);
+            }
+        }
+    }
+
+    StringTable            strtab;
+    std::vector<Elf64_Sym> symbols(1, Elf64_Sym{});
+    std::uint32_t          first_global = 0;
+    for (const auto idx : order) {
+        const auto& symbol = this->m_symbols[idx];
+
+        if (symbol.binding == SymbolBinding::Global && first_global == 0) {
+            first_global = static_cast<std::uint32_t>(symbols.size());
+        }
+
+        const auto type = [&]() -> unsigned char {
+            switch (symbol.type) {
+                case SymbolType::Function: {
+                    return STT_FUNC;
+                }
+                case SymbolType::Object: {
+                    return STT_OBJECT;
+                }
+                case SymbolType::Section: {
+                    return STT_SECTION;
+                }
+                default: {
+                    return STT_NOTYPE;
+                }
+            }
+        }();
+        const auto binding = symbol.binding == SymbolBinding::Global
+                               ? STB_GLOBAL
+                               : STB_LOCAL;
+
+        Elf64_Sym entry{};
+        entry.st_name  = strtab.add(symbol.name);
+        entry.st_info =
+          static_cast<unsigned char>(ELF64_ST_INFO(binding, type));
+        entry.st_shndx = symbol.section.has_value()
+                           ? section_index(symbol.section.value())
+                           : static_cast<std::uint16_t>(SHN_UNDEF);
+        entry.st_value = symbol.value;
+        entry.st_size  = symbol.size;
+        symbols.push_back(entry);
+    }
+    if (first_global == 0) {
+        first_global = static_cast<std::uint32_t>(symbols.size());
+    }
+
+    StringTable             shstrtab;
+    std::vector<Elf64_Shdr> headers(section_count, Elf64_Shdr{});
+    Image                   image;
+
+    image.write(Elf64_Ehdr{});
+
+    for (std::size_t idx = 0; idx < this->m_sections.size(); ++idx) {
+        const auto& section = this->m_sections[idx];
+        auto&       header  = headers[section_index(idx)];
+
+        header.sh_name      = shstrtab.add(section.name);
+        header.sh_addralign = section.alignment;
+
+        switch (section.kind) {
+            case SectionKind::Code: {
+                header.sh_type  = SHT_PROGBITS;
+                header.sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+                break;
+            }
+            case SectionKind::ReadOnlyData: {
+                header.sh_type  = SHT_PROGBITS;
+                header.sh_flags = SHF_ALLOC;
+                break;
+            }
+            case SectionKind::Data: {
+                header.sh_type  = SHT_PROGBITS;
+                header.sh_flags = SHF_ALLOC | SHF_WRITE;
+                break;
+            }
+            default: {
+                header.sh_type  = SHT_NOBITS;
+                header.sh_flags = SHF_ALLOC | SHF_WRITE;
+                break;
+            }
+        }
+
+        image.align(section.alignment);
+        header.sh_offset = image.size();
+        if (section.kind == SectionKind::Uninitialized) {
+            header.sh_size = section.uninitialized_size;
+        } else {
+            header.sh_size = section.data.size();
+            image.write(section.data);
+        }
+    }
+
+    for (std::size_t rela = 0; rela < relocated.size(); ++rela) {
+        const auto& section = this->m_sections[relocated[rela]];
+        auto&       header  = headers[1 + this->m_sections.size() + rela];
+
+        header.sh_name      = shstrtab.add(".rela" + section.name);
+        header.sh_type      = SHT_RELA;
+        header.sh_flags     = SHF_INFO_LINK;
+        header.sh_link      = symtab_index;
+        header.sh_info      = section_index(relocated[rela]);
+        header.sh_addralign = 8;
+        header.sh_entsize   = sizeof(Elf64_Rela);
+
+        image.align(8);
+        header.sh_offset = image.size();
+        for (const auto& relocation : section.relocations) {
+            Elf64_Rela entry{};
+            entry.r_offset = relocation.offset;
+            entry.r_info   = ELF64_R_INFO(
+              final_index[relocation.symbol], relocation.type
+            );
+            entry.r_addend = relocation.addend;
+            image.write(entry);
+        }
+        header.sh_size = image.size() - header.sh_offset;
+    }
+
+    auto& symtab_header        = headers[symtab_index];
+    symtab_header.sh_name      = shstrtab.add(".symtab");
+    symtab_header.sh_type      = SHT_SYMTAB;
+    symtab_header.sh_link      = strtab_index;
+    symtab_header.sh_info      = first_global;
+    symtab_header.sh_addralign = 8;
+    symtab_header.sh_entsize   = sizeof(Elf64_Sym);
+    image.align(8);
+    symtab_header.sh_offset = image.size();
+    for (const auto& symbol : symbols) { image.write(symbol); }
+    symtab_header.sh_size = image.size() - symtab_header.sh_offset;
+
+    auto& strtab_header        = headers[strtab_index];
+    strtab_header.sh_name      = shstrtab.add(".strtab");
+    strtab_header.sh_type      = SHT_STRTAB;
+    strtab_header.sh_addralign = 1;
+    strtab_header.sh_offset    = image.size();
+    strtab_header.sh_size      = strtab.bytes().size();
+    image.write(strtab.bytes());
+
+    // Empty, tells the linker the stack does not have to be executable
+    auto& note_header        = headers[note_index];
+    note_header.sh_name      = shstrtab.add(".note.GNU-stack");
+    note_header.sh_type      = SHT_PROGBITS;
+    note_header.sh_addralign = 1;
+    note_header.sh_offset    = image.size();
+
+    auto& shstrtab_header        = headers[shstrtab_index];
+    shstrtab_header.sh_name      = shstrtab.add(".shstrtab");
+    shstrtab_header.sh_type      = SHT_STRTAB;
+    shstrtab_header.sh_addralign = 1;
+    shstrtab_header.sh_offset    = image.size();
+    shstrtab_header.sh_size      = shstrtab.bytes().size();
+    image.write(shstrtab.bytes());
+
+    image.align(8);
+    const auto section_headers_offset = image.size();
+    for (const auto& header : headers) { image.write(header); }
+
+    auto bytes = image.take();
+
+    Elf64_Ehdr header{};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS]   = ELFCLASS64;
+    header.e_ident[EI_DATA]    = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI]   = ELFOSABI_SYSV;
+    header.e_type              = ET_REL;
+    header.e_machine           = EM_X86_64;
+    header.e_version           = EV_CURRENT;
+    header.e_shoff             = section_headers_offset;
+    header.e_ehsize            = sizeof(Elf64_Ehdr);
+    header.e_shentsize         = sizeof(Elf64_Shdr);
+    header.e_shnum             = static_cast<std::uint16_t>(section_count);
+    header.e_shstrndx          = static_cast<std::uint16_t>(shstrtab_index);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    return bytes;
+}
+
+auto ObjectFile::link(const std::string_view entry) const
+  -> std::expected<std::vector<std::uint8_t>, LinkError> {
+    const auto entry_symbol = this->find_symbol(entry);
+    if (!entry_symbol.has_value()) {
+        return std::unexpected(LinkError::UndefinedSymbol);
+    }
+    const auto live = this->live_sections(entry_symbol.value());
+
+    // One PT_LOAD per permission set, in the order they are laid out: code
+    // shares its segment with the headers, .bss extends the data segment
+    struct Segment {
+        std::uint32_t            flags;
+        std::vector<std::size_t> sections;
+        std::uint64_t            offset      = 0;
+        std::uint64_t            address     = 0;
+        std::uint64_t            file_size   = 0;
+        std::uint64_t            memory_size = 0;
+    };
+    std::array<Segment, 3> segments{
+        Segment{ .flags = PF_R | PF_X, .sections = {} },
+        Segment{ .flags = PF_R, .sections = {} },
+        Segment{ .flags = PF_R | PF_W, .sections = {} },
+    };
+
+    for (std::size_t idx = 0; idx < this->m_sections.size(); ++idx) {
+        if (!live[idx]) { continue; }
+
+        const auto& section = this->m_sections[idx];
+        switch (section.kind) {
+            case SectionKind::Code: {
+                segments[0].sections.push_back(idx);
+                break;
+            }
+            case SectionKind::ReadOnlyData: {
+                segments[1].sections.push_back(idx);
+                break;
+            }
+            default: {
+                segments[2].sections.push_back(idx);
+                break;
+            }
+        }
+    }
+    // Initialized data first, so that .bss stays at the end of its segment
+    std::ranges::stable_partition(segments[2].sections, [&](const auto idx) {
+        return this->m_sections[idx].kind != SectionKind::Uninitialized;
+    });
+
+    std::size_t load_count = 0;
+    for (const auto& segment : segments) {
+        if (!segment.sections.empty()) { ++load_count; }
+    }
+    // Plus PT_GNU_STACK, to get a non-executable stack
+    const auto program_header_count = load_count + 1;
+    const auto headers_size =
+      sizeof(Elf64_Ehdr) + program_header_count * sizeof(Elf64_Phdr);
+
+    // Lay everything out, a section's file offset and address are congruent
+    // modulo the page size so it can be mapped straight from the file
+    std::vector<std::uint64_t> addresses(this->m_sections.size(), 0);
+    std::vector<std::uint64_t> offsets(this->m_sections.size(), 0);
+    std::uint64_t              file_end    = headers_size;
+    std::uint64_t              address_end = base_address + headers_size;
+    bool                       first       = true;
+    for (auto& segment : segments) {
+        if (segment.sections.empty()) { continue; }
+
+        if (first) {
+            // The headers are mapped along with the code
+            segment.offset      = 0;
+            segment.address     = base_address;
+            segment.file_size   = headers_size;
+            segment.memory_size = headers_size;
+            first               = false;
+        } else {
+            segment.offset  = file_end;
+            segment.address = align_up(address_end, page_size)
+                              + (file_end % page_size);
+        }
+
+        for (const auto idx : segment.sections) {
+            const auto& section = this->m_sections[idx];
+            const auto  end     = segment.address + segment.memory_size;
+            const auto  padding = align_up(end, section.alignment) - end;
+
+            addresses[idx] = end + padding;
+            offsets[idx]   = segment.offset + segment.memory_size + padding;
+
+            if (section.kind == SectionKind::Uninitialized) {
+                segment.memory_size += padding + section.uninitialized_size;
+            } else {
+                segment.memory_size += padding + section.data.size();
+                segment.file_size    = segment.memory_size;
+            }
+        }
+        file_end    = segment.offset + segment.file_size;
+        address_end = segment.address + segment.memory_size;
+    }
+
+    const auto symbols = this->resolve_symbols(addresses, {});
+    if (!symbols.has_value()) { return std::unexpected(symbols.error()); }
+
+    std::vector<std::uint8_t> image(file_end, 0);
+
+    for (std::size_t idx = 0; idx < this->m_sections.size(); ++idx) {
+        const auto& section = this->m_sections[idx];
+        if (!live[idx] || section.kind == SectionKind::Uninitialized) {
+            continue;
+        }
+
+        auto       bytes = section.data;
+        const auto result =
+          this->relocate(idx, bytes, addresses, symbols.value());
+        if (!result.has_value()) { return std::unexpected(result.error()); }
+
+        std::ranges::copy(
+          bytes, image.begin() + static_cast<std::ptrdiff_t>(offsets[idx])
+        );
+    }
+
+    Elf64_Ehdr header{};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS]   = ELFCLASS64;
+    header.e_ident[EI_DATA]    = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI]   = ELFOSABI_SYSV;
+    header.e_type              = ET_EXEC;
+    header.e_machine           = EM_X86_64;
+    header.e_version           = EV_CURRENT;
+    header.e_entry             = symbols.value()[entry_symbol.value()];
+    header.e_phoff             = sizeof(Elf64_Ehdr);
+    header.e_ehsize            = sizeof(Elf64_Ehdr);
+    header.e_phentsize         = sizeof(Elf64_Phdr);
+    header.e_phnum = static_cast<std::uint16_t>(program_header_count);
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    auto       program_header_offset = sizeof(Elf64_Ehdr);
+    const auto write_program_header = [&](const Elf64_Phdr& program_header) {
+        std::memcpy(
+          image.data() + program_header_offset,
+          &program_header,
+          sizeof(program_header)
+        );
+        program_header_offset += sizeof(program_header);
+    };
+
+    for (const auto& segment : segments) {
+        if (segment.sections.empty()) { continue; }
+
+        Elf64_Phdr program_header{};
+        program_header.p_type   = PT_LOAD;
+        program_header.p_flags  = segment.flags;
+        program_header.p_offset = segment.offset;
+        program_header.p_vaddr  = segment.address;
+        program_header.p_paddr  = segment.address;
+        program_header.p_filesz = segment.file_size;
+        program_header.p_memsz  = segment.memory_size;
+        program_header.p_align  = page_size;
+        write_program_header(program_header);
+    }
+
+    Elf64_Phdr stack{};
+    stack.p_type  = PT_GNU_STACK;
+    stack.p_flags = PF_R | PF_W;
+    stack.p_align = 16;
+    write_program_header(stack);
+
+    return image;
+}
+
+auto ObjectFile::load_size() const -> std::uint64_t {
+    return this->flat_layout().back();
+}
+
+auto ObjectFile::load(
+  const std::uint64_t                                   base,
+  const std::unordered_map<std::string, std::uint64_t>& externals,
+  const std::string_view                                entry
+) const -> std::expected<LoadedImage, LinkError> {
+    const auto entry_symbol = this->find_symbol(entry);
+    if (!entry_symbol.has_value()) {
+        return std::unexpected(LinkError::UndefinedSymbol);
+    }
+
+    const auto offsets = this->flat_layout();
+
+    std::vector<std::uint64_t> addresses(this->m_sections.size(), 0);
+    for (std::size_t idx = 0; idx < this->m_sections.size(); ++idx) {
+        addresses[idx] = base + offsets[idx];
+    }
+
+    const auto symbols = this->resolve_symbols(addresses, externals);
+    if (!symbols.has_value()) { return std::unexpected(symbols.error()); }
+
+    LoadedImage loaded{
+        .bytes = std::vector<std::uint8_t>(offsets.back(), 0),
+        .entry = symbols.value()[entry_symbol.value()],
+    };
+
+    for (std::size_t idx = 0; idx < this->m_sections.size(); ++idx) {
+        const auto& section = this->m_sections[idx];
+        if (section.kind == SectionKind::Uninitialized) { continue; }
+
+        auto       bytes = section.data;
+        const auto result =
+          this->relocate(idx, bytes, addresses, symbols.value());
+        if (!result.has_value()) { return std::unexpected(result.error()); }
+
+        std::ranges::copy(
+          bytes,
+          loaded.bytes.begin() + static_cast<std::ptrdiff_t>(offsets[idx])
+        );
+    }
+
+    return loaded;
+}
+
+auto ObjectFile::find_symbol(const std::string_view name) const
+  -> std::optional<std::uint32_t> {
+    std::optional<std::uint32_t> local;
+    for (std::uint32_t idx = 0; idx < this->m_symbols.size(); ++idx) {
+        const auto& symbol = this->m_symbols[idx];
+        if (symbol.name != name || !symbol.section.has_value()) { continue; }
+        if (symbol.binding == SymbolBinding::Global) { return idx; }
+        if (!local.has_value()) { local = idx; }
+    }
+    return local;
+}
+
+auto ObjectFile::global_symbols() const
+  -> std::unordered_map<std::string_view, std::uint32_t> {
+    std::unordered_map<std::string_view, std::uint32_t> globals;
+    for (std::uint32_t idx = 0; idx < this->m_symbols.size(); ++idx) {
+        const auto& symbol = this->m_symbols[idx];
+        if (symbol.binding == SymbolBinding::Global
+            && symbol.section.has_value()) {
+            globals.try_emplace(symbol.name, idx);
+        }
+    }
+    return globals;
+}
+
+auto ObjectFile::live_sections(const std::uint32_t root) const
+  -> std::vector<bool> {
+    const auto globals = this->global_symbols();
+
+    std::vector<bool>          live(this->m_sections.size(), false);
+    std::vector<std::uint32_t> pending;
+    const auto                 mark = [&](const std::uint32_t symbol) {
+        auto section = this->m_symbols[symbol].section;
+        if (!section.has_value()) {
+            const auto global = globals.find(this->m_symbols[symbol].name);
+            // Left to resolve_symbols() to report
+            if (global == globals.end()) { return; }
+            section = this->m_symbols[global->second].section;
+        }
+        if (!live[section.value()]) {
+            live[section.value()] = true;
+            pending.push_back(section.value());
+        }
+    };
+
+    mark(root);
+    while (!pending.empty()) {
+        const auto section = pending.back();
+        pending.pop_back();
+        for (const auto& relocation : this->m_sections[section].relocations) {
+            mark(relocation.symbol);
+        }
+    }
+
+    return live;
+}
+
+auto ObjectFile::flat_layout() const -> std::vector<std::uint64_t> {
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(this->m_sections.size() + 1);
+
+    std::uint64_t end = 0;
+    for (const auto& section : this->m_sections) {
+        end = align_up(end, section.alignment);
+        offsets.push_back(end);
+        end += section.kind == SectionKind::Uninitialized
+                 ? section.uninitialized_size
+                 : section.data.size();
+    }
+    offsets.push_back(end);
+
+    return offsets;
+}
+
+auto ObjectFile::resolve_symbols(
+  const std::vector<std::uint64_t>&                     addresses,
+  const std::unordered_map<std::string, std::uint64_t>& externals
+) const -> std::expected<std::vector<std::uint64_t>, LinkError> {
+    const auto globals = this->global_symbols();
+    const auto address = [&](const Symbol& symbol) {
+        return addresses[symbol.section.value()] + symbol.value;
+    };
+
+    std::vector<std::uint64_t> resolved;
+    resolved.reserve(this->m_symbols.size());
+    for (const auto& symbol : this->m_symbols) {
+        if (symbol.section.has_value()) {
+            resolved.push_back(address(symbol));
+            continue;
+        }
+
+        if (const auto global = globals.find(symbol.name);
+            global != globals.end()) {
+            resolved.push_back(address(this->m_symbols[global->second]));
+            continue;
+        }
+
+        const auto external = externals.find(symbol.name);
+        if (external == externals.end()) {
+            return std::unexpected(LinkError::UndefinedSymbol);
+        }
+        resolved.push_back(external->second);
+    }
+
+    return resolved;
+}
+
+auto ObjectFile::relocate(
+  const std::size_t                 section,
+  std::vector<std::uint8_t>&        bytes,
+  const std::vector<std::uint64_t>& addresses,
+  const std::vector<std::uint64_t>& symbols
+) const -> std::expected<void, LinkError> {
+    for (const auto& relocation : this->m_sections[section].relocations) {
+        const auto value = static_cast<std::int64_t>(symbols[relocation.symbol])
+                           + relocation.addend;
+        const auto place =
+          static_cast<std::int64_t>(addresses[section] + relocation.offset);
+
+        switch (relocation.type) {
+            case R_X86_64_PC32:
+            case R_X86_64_PLT32: {
+                const auto relative = value - place;
+                if (!fits_i32(relative)) {
+                    return std::unexpected(LinkError::RelocationOverflow);
+                }
+                patch(
+                  bytes,
+                  relocation.offset,
+                  static_cast<std::uint64_t>(relative),
+                  4
+                );
+                break;
+            }
+            case R_X86_64_32S: {
+                if (!fits_i32(value)) {
+                    return std::unexpected(LinkError::RelocationOverflow);
+                }
+                patch(
+                  bytes, relocation.offset, static_cast<std::uint64_t>(value), 4
+                );
+                break;
+            }
+            case R_X86_64_32: {
+                if (value < 0
+                    || value > std::numeric_limits<std::uint32_t>::max()) {
+                    return std::unexpected(LinkError::RelocationOverflow);
+                }
+                patch(
+                  bytes, relocation.offset, static_cast<std::uint64_t>(value), 4
+                );
+                break;
+            }
+            case R_X86_64_64: {
+                patch(
+                  bytes, relocation.offset, static_cast<std::uint64_t>(value), 8
+                );
+                break;
+            }
+            default: {
+                return std::unexpected(LinkError::UnsupportedRelocation);
+            }
+        }
+    }
+
+    return {};
+}
+
+} // namespace elf
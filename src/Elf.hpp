@@ -0,0 +1,232 @@
+#ifndef ELF_HPP
+#define ELF_HPP
+
+#define FMT_HEADER_ONLY
+
+#include <cstddef>
+#include <cstdint>
+#include <elf.h>
+#include <expected>
+#include <fmt/format.h>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Minimal reader and writer for ELF64 x86-64 relocatable objects (ET_REL)
+/// and `ar` archives of them, and a static linker turning objects merged
+/// into one into an executable (ET_EXEC).
+///
+/// Sections, symbols and relocations are collected in any order, the
+/// symbol table is sorted (locals first, as the format requires) and every
+/// index is fixed up when the object is serialized.
+namespace elf {
+
+enum class SectionKind : std::uint8_t {
+    Code = 0,
+    ReadOnlyData,
+    Data,
+    // Only has a size, takes no room in the file (.bss)
+    Uninitialized,
+    Max
+};
+
+enum class SymbolBinding : std::uint8_t {
+    Local = 0,
+    Global,
+};
+
+enum class SymbolType : std::uint8_t {
+    None = 0,
+    Function,
+    Object,
+    Section,
+};
+
+struct Symbol {
+    std::string                  name;
+    // Index returned by ObjectFile::add_section, nullopt for undefined
+    // symbols the linker has to resolve
+    std::optional<std::uint32_t> section{};
+    std::uint64_t                value   = 0;
+    std::uint64_t                size    = 0;
+    SymbolBinding                binding = SymbolBinding::Local;
+    SymbolType                   type    = SymbolType::None;
+};
+
+enum class LinkError : std::uint8_t {
+    UndefinedSymbol = 0,
+    RelocationOverflow,
+    UnsupportedRelocation,
+    // Not an ELF64 x86-64 relocatable object, or an archive of them, the
+    // way link() needs it
+    InvalidInput,
+    Max
+};
+
+struct Relocation {
+    std::uint64_t offset;
+    // One of the R_X86_64_* constants
+    std::uint32_t type;
+    // Index returned by ObjectFile::add_symbol
+    std::uint32_t symbol;
+    std::int64_t  addend;
+};
+
+/// Sections copied one after the other into memory, see ObjectFile::load
+struct LoadedImage {
+    std::vector<std::uint8_t> bytes;
+    std::uint64_t             entry;
+};
+
+class ObjectFile {
+  public:
+    /// Only the allocated sections are kept, along with their symbols and
+    /// relocations
+    [[nodiscard]] static auto read(const std::span<const std::uint8_t> bytes)
+      -> std::expected<ObjectFile, LinkError>;
+    /// Every object of a System V (GNU) archive, in order
+    [[nodiscard]] static auto
+      read_archive(const std::span<const std::uint8_t> bytes)
+        -> std::expected<std::vector<ObjectFile>, LinkError>;
+
+    /// Adds a section along with its section symbol
+    [[nodiscard]] auto add_section(
+      std::string         name,
+      const SectionKind   kind,
+      const std::uint64_t alignment
+    ) -> std::uint32_t;
+    [[nodiscard]] auto add_symbol(Symbol symbol) -> std::uint32_t;
+    void
+      add_relocation(const std::uint32_t section, const Relocation& relocation);
+
+    [[nodiscard]] auto data(const std::uint32_t section)
+      -> std::vector<std::uint8_t>&;
+    /// Grows an Uninitialized section, returns the offset of the new space
+    [[nodiscard]] auto
+      reserve(const std::uint32_t section, const std::uint64_t size)
+        -> std::uint64_t;
+    [[nodiscard]] auto section_symbol(const std::uint32_t section) const
+      -> std::uint32_t;
+    [[nodiscard]] auto defines(const std::string_view name) const -> bool;
+    /// Names of the undefined symbols no global symbol is defined under
+    [[nodiscard]] auto undefined_symbols() const -> std::vector<std::string>;
+
+    /// Adds the sections, symbols and relocations of `other`. Undefined
+    /// symbols of either object are then resolved by the global symbols of
+    /// the other one.
+    void append(const ObjectFile& other);
+
+    [[nodiscard]] auto serialize() const -> std::vector<std::uint8_t>;
+
+    /// Lays the sections out in memory, applies every relocation and returns
+    /// a static executable starting at the global symbol `entry`. Segments
+    /// share file pages with their neighbours, only their virtual addresses
+    /// are page aligned, so the image carries no padding. Sections `entry`
+    /// does not lead to are left out, like `ld --gc-sections` does.
+    [[nodiscard]] auto link(const std::string_view entry) const
+      -> std::expected<std::vector<std::uint8_t>, LinkError>;
+
+    /// Bytes needed to load the object, see load()
+    [[nodiscard]] auto load_size() const -> std::uint64_t;
+    /// Relocates every section for a flat copy at `base`, sections following
+    /// each other at their alignment (`base` must be page aligned), .bss
+    /// included as zeros. Undefined symbols no global symbol resolves are
+    /// looked up in `externals`, `entry` is the symbol whose address is
+    /// handed back.
+    [[nodiscard]] auto load(
+      const std::uint64_t                                   base,
+      const std::unordered_map<std::string, std::uint64_t>& externals,
+      const std::string_view                                entry
+    ) const -> std::expected<LoadedImage, LinkError>;
+
+  private:
+    struct Section {
+        std::string               name;
+        SectionKind               kind;
+        std::uint64_t             alignment;
+        std::vector<std::uint8_t> data{};
+        std::uint64_t             uninitialized_size = 0;
+        std::uint32_t             symbol             = 0;
+        std::vector<Relocation>   relocations{};
+    };
+
+    /// Offset of every section in a flat image, followed by its total size
+    [[nodiscard]] auto flat_layout() const -> std::vector<std::uint64_t>;
+    /// First global, or else local, symbol defined under `name`
+    [[nodiscard]] auto find_symbol(const std::string_view name) const
+      -> std::optional<std::uint32_t>;
+    /// First global symbol defined under every name
+    [[nodiscard]] auto global_symbols() const
+      -> std::unordered_map<std::string_view, std::uint32_t>;
+    /// Whether every section is reachable from the section of `root`,
+    /// following the relocations
+    [[nodiscard]] auto live_sections(const std::uint32_t root) const
+      -> std::vector<bool>;
+    /// Address of every symbol, every section being loaded at its entry in
+    /// `addresses`. Undefined symbols take the address of the first global
+    /// symbol defined under their name, or else of their entry in
+    /// `externals`.
+    [[nodiscard]] auto resolve_symbols(
+      const std::vector<std::uint64_t>&                     addresses,
+      const std::unordered_map<std::string, std::uint64_t>& externals
+    ) const -> std::expected<std::vector<std::uint64_t>, LinkError>;
+    /// Applies the relocations of `section` to `bytes`, see resolve_symbols()
+    [[nodiscard]] auto relocate(
+      const std::size_t                 section,
+      std::vector<std::uint8_t>&        bytes,
+      const std::vector<std::uint64_t>& addresses,
+      const std::vector<std::uint64_t>& symbols
+    ) const -> std::expected<void, LinkError>;
+
+    std::vector<Section> m_sections;
+    std::vector<Symbol>  m_symbols;
+};
+
+} // namespace elf
+
+/// {fmt} Custom Formatters
+
+template<>
+struct fmt::formatter<elf::LinkError> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const elf::LinkError& error, FormatContext& ctx) {
+        static_assert(
+          std::to_underlying(elf::LinkError::Max) == 4,
+          "[INTERNAL ERROR] fmt::formatter<elf::LinkError> requires to "
+          "handle all enum variants"
+        );
+
+        const auto enum_to_str = [](const elf::LinkError& error) {
+            switch (error) {
+                case elf::LinkError::UndefinedSymbol: {
+                    return "LinkError::UndefinedSymbol";
+                }
+                case elf::LinkError::RelocationOverflow: {
+                    return "LinkError::RelocationOverflow";
+                }
+                case elf::LinkError::UnsupportedRelocation: {
+                    return "LinkError::UnsupportedRelocation";
+                }
+                case elf::LinkError::InvalidInput: {
+                    return "LinkError::InvalidInput";
+                }
+                default: {
+                    return "Unknown Link Error";
+                }
+            }
+        };
+
+        return fmt::format_to(ctx.out(), "{}", enum_to_str(error));
+    }
+};
+
+#endif // ELF_HPP
@@ -1,65 +1,84 @@
 #include "Error.hpp"
+#include "Compiler.hpp"
 
-[[nodiscard]] auto compute_line_spans(const std::string& file_contents)
-  -> std::vector<Span> {
+[[nodiscard]] auto compute_line_spans(
+  const std::string_view file_contents,
+  const std::uint32_t    file_id
+) -> std::vector<Span> {
     std::vector<Span> line_spans;
 
+    // Every line span ends on its '\n', inclusive
     std::size_t start = 0;
     for (std::size_t i = 0; i < file_contents.size(); ++i) {
         if (file_contents[i] == '\n') {
-            line_spans.push_back(Span::create("", start, ++i));
+            line_spans.push_back(Span::create(file_id, start, i));
             start = i + 1;
         }
     }
 
+    // Last line without a trailing newline
+    if (start < file_contents.size()) {
+        line_spans.push_back(
+          Span::create(file_id, start, file_contents.size() - 1)
+        );
+    }
+
     return line_spans;
 }
 
-void print_error(const RackError& error, const std::string& file_contents) {
+void print_error(const Compiler& compiler, const RackError& error) {
+    const auto file_contents =
+      compiler.files().contents(error.span.file_id());
     if (file_contents.empty()) { return; }
 
     fmt::print(stderr, fmt::fg(fmt::color::red), "error");
     fmt::print(stderr, fmt::emphasis::bold, ": {}\n", error.message);
 
     // Find in which line is present the error span
-    std::size_t error_line_index  = 0;
-    std::size_t error_line_number = 0;
-    const auto  line_spans        = compute_line_spans(file_contents);
+    std::size_t error_line_index = 0;
+    const auto  line_spans =
+      compute_line_spans(file_contents, error.span.file_id());
     for (std::size_t line_index = 0; line_index < line_spans.size();
          ++line_index) {
         const auto& line_span = line_spans[line_index];
-        if (error.span.start() + 1 >= line_span.start() && error.span.start() + 1 <= line_span.end()) {
+        if (error.span.start() >= line_span.start()
+            && error.span.start() <= line_span.end()) {
             error_line_index = line_index;
-        }
-
-        if (error.span.end() + 1 >= line_span.start() && error.span.end() + 1 <= line_span.end()) {
-            error_line_number = line_index + 1;
+            break;
         }
     }
+    const auto& error_line_span   = line_spans[error_line_index];
+    const auto  error_line_number = error_line_index + 1;
 
     fmt::println(
       stderr,
       " --> {}:{}:{}",
-      error.span.file_id(),
+      compiler.files().path(error.span.file_id()),
       error_line_number,
-      error.span.start() + 1
+      error.span.start() - error_line_span.start() + 1
     );
     fmt::println(stderr, "  |");
     fmt::print(stderr, "  {} \t", error_line_number);
 
-    // Print error line contents
-    const auto& error_line_span     = line_spans[error_line_index];
-    const auto  error_line_contents = file_contents.substr(
+    // Print error line contents, without its newline
+    auto error_line_contents = file_contents.substr(
       error_line_span.start(),
       (error_line_span.end() - error_line_span.start() + 1)
     );
-    fmt::print(stderr, "{}", error_line_contents);
+    if (error_line_contents.ends_with('\n')) {
+        error_line_contents.remove_suffix(1);
+    }
+    fmt::print(stderr, "{}\n", error_line_contents);
 
-    // Print '^^^^' below span and error message next
+    // Print '^^^^' below span and error message next, a span running over
+    // several lines is only underlined up to the end of its first one
     const auto spaces =
       std::string(error.span.start() - error_line_span.start(), ' ');
-    const auto carets =
-      std::string(error.span.end() + 1 - error.span.start() + 1, '^');
+    const auto carets = std::string(
+      std::min(error.span.end(), error_line_span.end()) - error.span.start()
+        + 1,
+      '^'
+    );
     fmt::print(
       stderr,
       fmt::fg(fmt::color::red),
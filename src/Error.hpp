@@ -4,10 +4,12 @@
 #define FMT_HEADER_ONLY
 
 #include "Utility.hpp"
+#include <algorithm>
 #include <dtslib/filesystem.hpp>
 #include <fmt/color.h>
 #include <fmt/format.h>
 #include <string>
+#include <string_view>
 
 // TODO: Maybe later implement the ability to provide a hint to the error
 //       e.g: std::optional<std::string> error;
@@ -16,9 +18,15 @@ struct RackError {
     Span        span;
 };
 
-[[nodiscard]] auto compute_line_spans(const std::string& file_contents)
-  -> std::vector<Span>;
+[[nodiscard]] auto compute_line_spans(
+  const std::string_view file_contents,
+  const std::uint32_t    file_id
+) -> std::vector<Span>;
 
-void print_error(const RackError& error, const std::string& file_contents);
+class Compiler;
+
+/// Prints `error` along with its source line, the span being resolved
+/// through `compiler`
+void print_error(const Compiler& compiler, const RackError& error);
 
 #endif // ERROR_HPP
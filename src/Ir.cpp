@@ -0,0 +1,421 @@
+#include "Ir.hpp"
+
+#include <span>
+
+namespace ir {
+
+namespace {
+
+/// Lowers one function, simulating the RPN stack with virtual registers
+class FunctionLowering {
+  public:
+    FunctionLowering(
+      const std::shared_ptr<Compiler>& compiler,
+      Module&                          module,
+      Function&                        function
+    )
+      : m_compiler{ compiler },
+        m_module{ module },
+        m_function{ function } {}
+
+    [[nodiscard]] auto lower(const std::span<const ast::Statement> body)
+      -> std::expected<void, LowerError> {
+        static_assert(
+          std::to_underlying(ast::StatementKind::Max) == 6,
+          "[INTERNAL ERROR] ir::lower() requires to handle all statement "
+          "kinds"
+        );
+
+        // Nesting is only bounded by the source, so it is not left to the
+        // call stack
+        std::vector<std::span<const ast::Statement>> pending{ body };
+        while (!pending.empty()) {
+            auto& statements = pending.back();
+            if (statements.empty()) {
+                pending.pop_back();
+                continue;
+            }
+
+            const auto& statement = statements.front();
+            statements            = statements.subspan(1);
+
+            switch (statement.kind) {
+                case ast::StatementKind::StringLiteral: {
+                    this->lower_string(statement.token);
+                    break;
+                }
+                case ast::StatementKind::NumberLiteral: {
+                    this->define(Instruction{
+                      .opcode    = Opcode::Const,
+                      .type      = Type::I64,
+                      .immediate = static_cast<std::int64_t>(
+                        statement.token.value(*this->m_compiler)
+                      ),
+                    });
+                    break;
+                }
+                case ast::StatementKind::Call: {
+                    const auto result = this->lower_call(statement.token);
+                    if (!result.has_value()) { return result; }
+                    break;
+                }
+                case ast::StatementKind::Arithmetic: {
+                    const auto result =
+                      this->lower_arithmetic(statement.token);
+                    if (!result.has_value()) { return result; }
+                    break;
+                }
+                case ast::StatementKind::Keyword: {
+                    fmt::print(
+                      stderr,
+                      "[INTERNAL ERROR] compile_keyword(): is not implemented "
+                      "yet\n"
+                    );
+                    break;
+                }
+                case ast::StatementKind::Block: {
+                    pending.push_back(statement.body());
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+        }
+
+        this->m_function.body.push_back(
+          Instruction{ .opcode = Opcode::Return }
+        );
+        return {};
+    }
+
+  private:
+    /// Appends `instruction` and pushes its result
+    void define(Instruction instruction) {
+        instruction.result = this->m_function.value_count++;
+        this->m_types.push_back(instruction.type);
+        this->m_function.body.push_back(instruction);
+        this->m_stack.push_back(instruction.result);
+    }
+
+    // FIXME: This currently assumes it cannot fail, but maybe it can (?)
+    void lower_string(const Token& token) {
+        const auto id = this->m_module.strings.intern(
+          decode_escapes(token.lexeme(*this->m_compiler))
+        );
+
+        // The size is pushed first, so that puts pops the address first
+        this->define(Instruction{
+          .opcode    = Opcode::Const,
+          .type      = Type::I64,
+          .immediate = static_cast<std::int64_t>(
+            this->m_module.strings.get(id).size()
+          ),
+        });
+        this->define(Instruction{
+          .opcode    = Opcode::String,
+          .type      = Type::Ptr,
+          .immediate = id,
+        });
+    }
+
+    [[nodiscard]] auto lower_call(const Token& token)
+      -> std::expected<void, LowerError> {
+        Instruction call{
+          .opcode        = Opcode::Call,
+          .builtin       = token.builtin(),
+          .operand_count = static_cast<std::uint8_t>(arity(token.builtin())),
+        };
+        const auto result = this->pop_operands(token, call);
+        if (!result.has_value()) { return result; }
+
+        this->m_function.body.push_back(call);
+        return {};
+    }
+
+    [[nodiscard]] auto lower_arithmetic(const Token& token)
+      -> std::expected<void, LowerError> {
+        const auto opcode = [&]() {
+            switch (token.type()) {
+                case TokenType::Plus: {
+                    return Opcode::Add;
+                }
+                case TokenType::Minus: {
+                    return Opcode::Sub;
+                }
+                default: {
+                    return Opcode::Mul;
+                }
+            }
+        }();
+
+        Instruction instruction{
+          .opcode        = opcode,
+          .type          = Type::I64,
+          .operand_count = 2,
+        };
+        const auto result = this->pop_operands(token, instruction);
+        if (!result.has_value()) { return result; }
+
+        this->define(instruction);
+        return {};
+    }
+
+    /// Pops the operands of `instruction`, the underflow and the operands of
+    /// the wrong type are reported at `token`
+    [[nodiscard]] auto
+      pop_operands(const Token& token, Instruction& instruction)
+        -> std::expected<void, LowerError> {
+        const std::size_t count = instruction.operand_count;
+        if (this->m_stack.size() < count) {
+            this->m_compiler->push_error(RackError{
+              fmt::format(
+                "{} pops {} value(s), but the stack only holds {}",
+                token.lexeme(*this->m_compiler),
+                count,
+                this->m_stack.size()
+              ),
+              token.span(),
+            });
+            return std::unexpected(LowerError::StackUnderflow);
+        }
+
+        const auto first = this->m_stack.size() - count;
+        for (std::size_t idx = 0; idx < count; ++idx) {
+            instruction.operands[idx] = this->m_stack[first + idx];
+
+            const auto type     = this->m_types[instruction.operands[idx]];
+            const auto expected = operand_type(instruction, idx);
+            if (type != expected) {
+                this->m_compiler->push_error(RackError{
+                  fmt::format(
+                    "operand {} of {} is {}, but it takes {}",
+                    idx + 1,
+                    token.lexeme(*this->m_compiler),
+                    type == Type::Ptr ? "a string" : "an integer",
+                    expected == Type::Ptr ? "a string" : "an integer"
+                  ),
+                  token.span(),
+                });
+                return std::unexpected(LowerError::TypeMismatch);
+            }
+        }
+        this->m_stack.resize(first);
+        return {};
+    }
+
+    std::shared_ptr<Compiler> m_compiler;
+    Module&                   m_module;
+    Function&                 m_function;
+    // Values pushed and not popped yet, top last
+    std::vector<Value>        m_stack;
+    // Type of every value defined so far
+    std::vector<Type>         m_types;
+};
+
+} // namespace
+
+auto Instruction::has_side_effects() const -> bool {
+    return this->opcode == Opcode::Call || this->opcode == Opcode::Return;
+}
+
+auto lower(
+  const std::shared_ptr<Compiler>& compiler,
+  const ast::Program&              program
+) -> std::expected<Module, LowerError> {
+    Module module;
+    module.functions.reserve(program.functions.size());
+
+    for (const auto& function : program.functions) {
+        auto& lowered = module.functions.emplace_back(
+          Function{ .name = function.name.lexeme(*compiler) }
+        );
+
+        FunctionLowering lowering(compiler, module, lowered);
+        const auto       result = lowering.lower(function.body);
+        if (!result.has_value()) { return std::unexpected(result.error()); }
+    }
+
+    return module;
+}
+
+auto verify(const Function& function) -> std::expected<void, std::string> {
+    static_assert(
+      std::to_underlying(Opcode::Max) == 7,
+      "[INTERNAL ERROR] ir::verify() requires to handle all opcodes"
+    );
+
+    // Void until the value is defined
+    std::vector<Type>  types(function.value_count, Type::Void);
+    std::vector<Value> stack;
+
+    for (const auto& instruction : function.body) {
+        const auto expected_type = [&]() {
+            switch (instruction.opcode) {
+                case Opcode::Const: {
+                    return Type::I64;
+                }
+                case Opcode::String: {
+                    return Type::Ptr;
+                }
+                case Opcode::Add:
+                case Opcode::Sub:
+                case Opcode::Mul: {
+                    return Type::I64;
+                }
+                default: {
+                    return Type::Void;
+                }
+            }
+        }();
+        if (instruction.type != expected_type) {
+            return std::unexpected(fmt::format(
+              "`{}`: expected a {} result",
+              instruction,
+              to_string(expected_type)
+            ));
+        }
+
+        if (instruction.opcode == Opcode::Call
+            || is_arithmetic(instruction.opcode)) {
+            const auto expected_count = instruction.opcode == Opcode::Call
+                                          ? arity(instruction.builtin)
+                                          : 2;
+            if (instruction.operand_count != expected_count) {
+                return std::unexpected(
+                  fmt::format("`{}`: wrong operand count", instruction)
+                );
+            }
+            if (stack.size() < instruction.operand_count) {
+                return std::unexpected(
+                  fmt::format("`{}`: operands not on the stack", instruction)
+                );
+            }
+            const auto first = stack.size() - instruction.operand_count;
+            for (std::size_t idx = 0; idx < instruction.operand_count; ++idx) {
+                if (stack[first + idx] != instruction.operands[idx]) {
+                    return std::unexpected(fmt::format(
+                      "`{}`: %{} is not in stack order",
+                      instruction,
+                      instruction.operands[idx]
+                    ));
+                }
+                const auto expected = operand_type(instruction, idx);
+                if (types[instruction.operands[idx]] != expected) {
+                    return std::unexpected(fmt::format(
+                      "`{}`: %{} is not a {}",
+                      instruction,
+                      instruction.operands[idx],
+                      to_string(expected)
+                    ));
+                }
+            }
+            stack.resize(first);
+        }
+
+        if (instruction.type != Type::Void) {
+            if (instruction.result >= function.value_count
+                || types[instruction.result] != Type::Void) {
+                return std::unexpected(fmt::format(
+                  "`{}`: %{} is defined twice", instruction, instruction.result
+                ));
+            }
+            types[instruction.result] = instruction.type;
+            stack.push_back(instruction.result);
+        }
+    }
+
+    if (function.body.empty()
+        || function.body.back().opcode != Opcode::Return) {
+        return std::unexpected("missing return");
+    }
+
+    return {};
+}
+
+auto arity(const Builtin builtin) -> std::size_t {
+    static_assert(
+      std::to_underlying(Builtin::Max) == 3,
+      "[INTERNAL ERROR] ir::arity() requires to handle all builtins"
+    );
+
+    switch (builtin) {
+        case Builtin::Print: {
+            return 1;
+        }
+        case Builtin::Puts: {
+            return 2;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+auto operand_type(const Instruction& instruction, const std::size_t idx)
+  -> Type {
+    if (instruction.opcode == Opcode::Call
+        && instruction.builtin == Builtin::Puts && idx == 1) {
+        return Type::Ptr;
+    }
+    return Type::I64;
+}
+
+auto is_arithmetic(const Opcode opcode) -> bool {
+    return opcode == Opcode::Add || opcode == Opcode::Sub
+           || opcode == Opcode::Mul;
+}
+
+auto fold(const Opcode opcode, const std::int64_t lhs, const std::int64_t rhs)
+  -> std::int64_t {
+    // Unsigned, signed overflow is undefined
+    const auto left  = static_cast<std::uint64_t>(lhs);
+    const auto right = static_cast<std::uint64_t>(rhs);
+    switch (opcode) {
+        case Opcode::Add: {
+            return static_cast<std::int64_t>(left + right);
+        }
+        case Opcode::Sub: {
+            return static_cast<std::int64_t>(left - right);
+        }
+        default: {
+            return static_cast<std::int64_t>(left * right);
+        }
+    }
+}
+
+auto to_string(const Type type) -> std::string_view {
+    static constexpr auto count = std::to_underlying(Type::Max);
+    static constexpr std::array<std::string_view, count> names = {
+        "void",
+        "i64",
+        "ptr",
+    };
+    return names[std::to_underlying(type)];
+}
+
+auto to_string(const Opcode opcode) -> std::string_view {
+    static constexpr auto count = std::to_underlying(Opcode::Max);
+    static constexpr std::array<std::string_view, count> names = {
+        "const",
+        "string",
+        "add",
+        "sub",
+        "mul",
+        "call",
+        "ret",
+    };
+    return names[std::to_underlying(opcode)];
+}
+
+auto to_string(const Builtin builtin) -> std::string_view {
+    static constexpr auto count = std::to_underlying(Builtin::Max);
+    static constexpr std::array<std::string_view, count> names = {
+        "<none>",
+        "print",
+        "puts",
+    };
+    return names[std::to_underlying(builtin)];
+}
+
+} // namespace ir
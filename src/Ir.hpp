@@ -0,0 +1,243 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#define FMT_HEADER_ONLY
+
+#include "Ast.hpp"
+#include "Compiler.hpp"
+#include "Lexer.hpp"
+#include "StringPool.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fmt/format.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Typed SSA form of the program, lowered from the AST and rewritten by the
+/// optimization passes (see PassManager) before reaching the backends.
+///
+/// Every value pushed by the RPN program becomes a virtual register defined
+/// once, and every builtin takes the values it pops as operands. Functions
+/// are straight-line code for now, a single block ending with Return.
+///
+/// The backends still generate stack code: values are pushed where they are
+/// defined and popped by their (single) user. Lowering produces operands in
+/// stack order, and passes have to preserve it, see verify().
+namespace ir {
+
+enum class Type : std::uint8_t {
+    Void = 0,
+    I64,
+    Ptr,
+    Max
+};
+
+enum class Opcode : std::uint8_t {
+    // I64 `immediate`
+    Const = 0,
+    // Ptr to the string `immediate` of Module::strings
+    String,
+    // I64 results of the first operand and the second one, wrapping around
+    // on overflow
+    Add,
+    Sub,
+    Mul,
+    // `builtin` applied to the operands, in the order they were pushed, or
+    // with Builtin::None the function named `callee`
+    Call,
+    // Leaves the function, values still alive are dropped
+    Return,
+    Max
+};
+
+/// Virtual register, numbered per function
+using Value = std::uint32_t;
+
+struct Instruction {
+    static constexpr std::size_t max_operands = 2;
+
+    Opcode                          opcode;
+    Type                            type          = Type::Void;
+    // Defined by the instruction, unless its type is Void
+    Value                           result        = 0;
+    Builtin                         builtin       = Builtin::None;
+    std::string_view                callee        = {};
+    std::uint8_t                    operand_count = 0;
+    std::array<Value, max_operands> operands      = {};
+    std::int64_t                    immediate     = 0;
+
+    [[nodiscard]] auto has_side_effects() const -> bool;
+};
+
+struct Function {
+    std::string_view         name = {};
+    std::vector<Instruction> body = {};
+    // Values are numbered below this
+    Value                    value_count = 0;
+};
+
+struct Module {
+    std::vector<Function> functions;
+    // Every string of the program, the literals and the ones created by the
+    // passes
+    StringPool            strings;
+};
+
+enum class LowerError : std::uint8_t {
+    StackUnderflow = 0,
+    TypeMismatch,
+    Max
+};
+
+/// Lowers the program, reporting values popped from an empty stack, and
+/// operands of the wrong type, to the Compiler
+[[nodiscard]] auto
+  lower(const std::shared_ptr<Compiler>& compiler, const ast::Program& program)
+    -> std::expected<Module, LowerError>;
+
+/// Checks that every value is defined once before its use, that results and
+/// operands are typed after their opcode, and that operands are in stack
+/// order: on top of the stack formed by the values defined and not used yet,
+/// last operand topmost. Returns the first violation.
+[[nodiscard]] auto verify(const Function& function)
+  -> std::expected<void, std::string>;
+
+/// Number of values `builtin` pops
+[[nodiscard]] auto arity(const Builtin builtin) -> std::size_t;
+
+/// Type of the operand `idx` of `instruction`: I64, except for the address
+/// puts takes second
+[[nodiscard]] auto
+  operand_type(const Instruction& instruction, const std::size_t idx) -> Type;
+
+/// Add, Sub or Mul
+[[nodiscard]] auto is_arithmetic(const Opcode opcode) -> bool;
+
+/// Result of the arithmetic `opcode` applied to constants, as computed at
+/// runtime
+[[nodiscard]] auto
+  fold(const Opcode opcode, const std::int64_t lhs, const std::int64_t rhs)
+    -> std::int64_t;
+
+[[nodiscard]] auto to_string(const Type type) -> std::string_view;
+[[nodiscard]] auto to_string(const Opcode opcode) -> std::string_view;
+[[nodiscard]] auto to_string(const Builtin builtin) -> std::string_view;
+
+} // namespace ir
+
+/// {fmt} Custom Formatters
+
+/// Renders an instruction as one line of IR, without indentation
+template<>
+struct fmt::formatter<ir::Instruction> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const ir::Instruction& instruction, FormatContext& ctx) {
+        auto out = ctx.out();
+        if (instruction.type != ir::Type::Void) {
+            out = fmt::format_to(
+              out,
+              "%{} = {} ",
+              instruction.result,
+              ir::to_string(instruction.type)
+            );
+        }
+        out = fmt::format_to(out, "{}", ir::to_string(instruction.opcode));
+
+        switch (instruction.opcode) {
+            case ir::Opcode::Const: {
+                return fmt::format_to(out, " {}", instruction.immediate);
+            }
+            case ir::Opcode::String: {
+                return fmt::format_to(out, " @str_{}", instruction.immediate);
+            }
+            case ir::Opcode::Call:
+            case ir::Opcode::Add:
+            case ir::Opcode::Sub:
+            case ir::Opcode::Mul: {
+                if (instruction.opcode == ir::Opcode::Call
+                    && instruction.builtin == Builtin::None) {
+                    out = fmt::format_to(out, " @{}", instruction.callee);
+                } else if (instruction.opcode == ir::Opcode::Call) {
+                    out = fmt::format_to(
+                      out, " {}", ir::to_string(instruction.builtin)
+                    );
+                }
+                for (std::size_t idx = 0; idx < instruction.operand_count;
+                     ++idx) {
+                    out = fmt::format_to(
+                      out,
+                      "{}%{}",
+                      idx == 0 ? " " : ", ",
+                      instruction.operands[idx]
+                    );
+                }
+                return out;
+            }
+            default: {
+                return out;
+            }
+        }
+    }
+};
+
+template<>
+struct fmt::formatter<ir::Function> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const ir::Function& function, FormatContext& ctx) {
+        auto out = fmt::format_to(ctx.out(), "fn {} {{\n", function.name);
+        for (const auto& instruction : function.body) {
+            out = fmt::format_to(out, "    {}\n", instruction);
+        }
+        return fmt::format_to(out, "}}");
+    }
+};
+
+template<>
+struct fmt::formatter<ir::LowerError> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const ir::LowerError& error, FormatContext& ctx) {
+        static_assert(
+          std::to_underlying(ir::LowerError::Max) == 2,
+          "[INTERNAL ERROR] fmt::formatter<ir::LowerError> requires to handle "
+          "all enum variants"
+        );
+
+        const auto enum_to_str = [](const ir::LowerError& error) {
+            switch (error) {
+                case ir::LowerError::StackUnderflow: {
+                    return "LowerError::StackUnderflow";
+                }
+                case ir::LowerError::TypeMismatch: {
+                    return "LowerError::TypeMismatch";
+                }
+                default: {
+                    return "Unknown Lower Error";
+                }
+            }
+        };
+
+        return fmt::format_to(ctx.out(), "{}", enum_to_str(error));
+    }
+};
+
+#endif // IR_HPP
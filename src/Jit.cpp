@@ -0,0 +1,174 @@
+#include "Jit.hpp"
+
+#include "X86.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+/// `print` runtime: the value in signed decimal followed by a newline
+void rack_print(const std::int64_t value) { fmt::print("{}\n", value); }
+
+/// `puts` runtime: `size` bytes starting at `data`
+void rack_puts(const char* data, const std::uint64_t size) {
+    std::fwrite(data, 1, size, stdout);
+}
+
+/// Adapts the generated calling convention to System V: arguments are
+/// moved to rdi/rsi and the stack is aligned to 16 bytes for the call. r8
+/// and r9 are preserved like the native runtime does, the peephole
+/// optimizer counts on it.
+void generate_trampoline(
+  std::vector<std::uint8_t>&        code,
+  const std::vector<x86::Register>& arguments,
+  const void*                       function
+) {
+    using enum x86::Mnemonic;
+    using x86::Register::R8, x86::Register::R9, x86::Register::Rax;
+    using x86::Register::Rbp, x86::Register::Rdi, x86::Register::Rsi;
+    using x86::Register::Rsp;
+
+    constexpr std::array parameters{ Rdi, Rsi };
+
+    std::vector<x86::Instruction> instructions{
+        { Push, Rbp },
+        { Push, R8 },
+        { Push, R9 },
+        { Mov, Rbp, Rsp },
+        { And, Rsp, x86::Immediate{ -16 } },
+    };
+    for (std::size_t idx = 0; idx < arguments.size(); ++idx) {
+        instructions.push_back({ Mov, parameters[idx], arguments[idx] });
+    }
+    instructions.push_back(
+      { Mov,
+        Rax,
+        x86::Immediate{ static_cast<std::int64_t>(
+          reinterpret_cast<std::uintptr_t>(function)
+        ) } }
+    );
+    instructions.push_back({ Call, Rax });
+    instructions.push_back({ Mov, Rsp, Rbp });
+    instructions.push_back({ Pop, R9 });
+    instructions.push_back({ Pop, R8 });
+    instructions.push_back({ Pop, Rbp });
+    instructions.push_back({ Ret });
+
+    std::vector<x86::Fixup> fixups;
+    for (const auto& instruction : instructions) {
+        const auto result = x86::encode(instruction, code, fixups);
+        if (!result.has_value()) {
+            fmt::print(
+              stderr,
+              "[INTERNAL ERROR] cannot encode `{}`: {}\n",
+              instruction,
+              result.error()
+            );
+            std::abort();
+        }
+    }
+}
+
+} // namespace
+
+namespace jit {
+
+auto Module::load(const elf::ObjectFile& object)
+  -> std::expected<Module, JitError> {
+    using x86::Register::R8, x86::Register::R9, x86::Register::Rdi;
+
+    if (!object.defines("func_main")) {
+        return std::unexpected(JitError::MissingMain);
+    }
+
+    const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    // Trampolines first, the object starts on the next page
+    std::vector<std::uint8_t> runtime;
+    const auto                print_offset = runtime.size();
+    generate_trampoline(
+      runtime, { Rdi }, reinterpret_cast<const void*>(&rack_print)
+    );
+    const auto puts_offset = runtime.size();
+    generate_trampoline(
+      runtime, { R9, R8 }, reinterpret_cast<const void*>(&rack_puts)
+    );
+
+    const auto object_offset =
+      (runtime.size() + page_size - 1) / page_size * page_size;
+    const auto size = object_offset + object.load_size();
+
+    // Strings are addressed with sign-extended 32-bit absolutes, the code
+    // has to live in the low 2 GiB like a statically linked executable
+    auto* memory = mmap(
+      nullptr,
+      size,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT,
+      -1,
+      0
+    );
+    if (memory == MAP_FAILED) { return std::unexpected(JitError::MapFailure); }
+
+    const auto base = reinterpret_cast<std::uint64_t>(memory);
+    const std::unordered_map<std::string, std::uint64_t> externals{
+        { "print", base + print_offset },
+        { "puts", base + puts_offset },
+    };
+
+    const auto loaded =
+      object.load(base + object_offset, externals, "func_main");
+    if (!loaded.has_value()) {
+        munmap(memory, size);
+        return std::unexpected(JitError::LinkFailure);
+    }
+
+    auto* bytes = static_cast<std::uint8_t*>(memory);
+    std::ranges::copy(runtime, bytes);
+    std::ranges::copy(loaded->bytes, bytes + object_offset);
+
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return std::unexpected(JitError::ProtectFailure);
+    }
+
+    return Module(
+      memory,
+      size,
+      reinterpret_cast<void (*)()>(static_cast<std::uintptr_t>(loaded->entry))
+    );
+}
+
+Module::Module(void* memory, const std::size_t size, void (*main)())
+  : m_memory{ memory }, m_size{ size }, m_main{ main } {}
+
+Module::~Module() {
+    if (this->m_memory != nullptr) { munmap(this->m_memory, this->m_size); }
+}
+
+Module::Module(Module&& other) noexcept
+  : m_memory{ std::exchange(other.m_memory, nullptr) },
+    m_size{ std::exchange(other.m_size, 0) },
+    m_main{ std::exchange(other.m_main, nullptr) } {}
+
+Module& Module::operator=(Module&& rhs) noexcept {
+    std::swap(this->m_memory, rhs.m_memory);
+    std::swap(this->m_size, rhs.m_size);
+    std::swap(this->m_main, rhs.m_main);
+    return *this;
+}
+
+void Module::run() const {
+    this->m_main();
+    std::fflush(stdout);
+}
+
+} // namespace jit
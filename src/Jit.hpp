@@ -0,0 +1,93 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#define FMT_HEADER_ONLY
+
+#include "Elf.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fmt/format.h>
+#include <utility>
+
+/// Runs generated code inside the compiler process: the object is relocated
+/// into freshly mapped memory, which is made executable once written (never
+/// writable and executable at the same time). The runtime routines are host
+/// functions reached through small trampolines, as the generated code does
+/// not follow the System V calling convention.
+namespace jit {
+
+enum class JitError : std::uint8_t {
+    MapFailure = 0,
+    LinkFailure,
+    ProtectFailure,
+    MissingMain,
+    Max
+};
+
+class Module {
+  public:
+    [[nodiscard]] static auto load(const elf::ObjectFile& object)
+      -> std::expected<Module, JitError>;
+
+    ~Module();
+    Module(const Module& other)            = delete;
+    Module(Module&& other) noexcept;
+    Module& operator=(const Module& rhs)   = delete;
+    Module& operator=(Module&& rhs) noexcept;
+
+    /// Calls `func_main`, output written by the program is flushed on return
+    void run() const;
+
+  private:
+    Module(void* memory, const std::size_t size, void (*main)());
+
+    void*       m_memory;
+    std::size_t m_size;
+    void (*m_main)();
+};
+
+} // namespace jit
+
+/// {fmt} Custom Formatters
+
+template<>
+struct fmt::formatter<jit::JitError> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const jit::JitError& error, FormatContext& ctx) {
+        static_assert(
+          std::to_underlying(jit::JitError::Max) == 4,
+          "[INTERNAL ERROR] fmt::formatter<jit::JitError> requires to handle "
+          "all enum variants"
+        );
+
+        const auto enum_to_str = [](const jit::JitError& error) {
+            switch (error) {
+                case jit::JitError::MapFailure: {
+                    return "JitError::MapFailure";
+                }
+                case jit::JitError::LinkFailure: {
+                    return "JitError::LinkFailure";
+                }
+                case jit::JitError::ProtectFailure: {
+                    return "JitError::ProtectFailure";
+                }
+                case jit::JitError::MissingMain: {
+                    return "JitError::MissingMain";
+                }
+                default: {
+                    return "Unknown Jit Error";
+                }
+            }
+        };
+
+        return fmt::format_to(ctx.out(), "{}", enum_to_str(error));
+    }
+};
+
+#endif // JIT_HPP
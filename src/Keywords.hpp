@@ -0,0 +1,118 @@
+#ifndef KEYWORDS_HPP
+#define KEYWORDS_HPP
+
+#include "Lexer.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/// Compile-time perfect hash over the reserved words of the language.
+///
+/// Identifiers are classified once by the lexer: a seed is searched at
+/// compile time so that every word in `words` lands in its own slot, and a
+/// lookup is then one hash plus one string compare, no matter how many
+/// keywords or builtins get added.
+namespace keywords {
+
+struct Word {
+    std::string_view spelling;
+    Keyword          keyword = Keyword::None;
+    Builtin          builtin = Builtin::None;
+};
+
+inline constexpr std::array words = {
+    Word{ "fn", Keyword::Fn },
+    Word{ "begin", Keyword::Begin },
+    Word{ "end", Keyword::End },
+    Word{ "print", Keyword::None, Builtin::Print },
+    Word{ "puts", Keyword::None, Builtin::Puts },
+};
+
+/// Seeded FNV-1a over every byte of the word. Two different words always
+/// give different keys for some seed, and identifiers longer than the
+/// longest reserved word never get here (see lookup()), so the loop stays
+/// short.
+[[nodiscard]] constexpr auto
+  hash(const std::uint32_t seed, const std::string_view word) -> std::uint32_t {
+    std::uint32_t key = 2166136261U ^ (seed * 2654435761U);
+    for (const char character : word) {
+        key ^= static_cast<unsigned char>(character);
+        key *= 16777619U;
+    }
+    return key ^ (key >> 16U);
+}
+
+[[nodiscard]] consteval auto max_length() -> std::size_t {
+    std::size_t length = 0;
+    for (const auto& word : words) {
+        length = std::max(length, word.spelling.size());
+    }
+    return length;
+}
+
+[[nodiscard]] consteval auto table_size() -> std::size_t {
+    std::size_t size = 1;
+    while (size < words.size() * 2) { size *= 2; }
+    return size;
+}
+
+struct Table {
+    std::uint32_t                  seed = 0;
+    std::array<Word, table_size()> slots{};
+    std::array<bool, table_size()> used{};
+};
+
+[[nodiscard]] consteval auto build_table() -> std::optional<Table> {
+    constexpr std::uint32_t max_seed = 1U << 16U;
+
+    for (std::uint32_t seed = 0; seed < max_seed; ++seed) {
+        Table table{};
+        table.seed = seed;
+
+        bool collision = false;
+        for (const auto& word : words) {
+            const auto slot = hash(seed, word.spelling) & (table_size() - 1);
+            if (table.used[slot]) {
+                collision = true;
+                break;
+            }
+            table.used[slot]  = true;
+            table.slots[slot] = word;
+        }
+
+        if (!collision) { return table; }
+    }
+
+    return std::nullopt;
+}
+
+inline constexpr auto table = build_table();
+
+static_assert(
+  table.has_value(),
+  "[INTERNAL ERROR] keywords: no perfect hash seed found, increase max_seed"
+);
+
+[[nodiscard]] constexpr auto lookup(const std::string_view identifier)
+  -> Word {
+    if (identifier.empty() || identifier.size() > max_length()) { return {}; }
+
+    const auto slot = hash(table->seed, identifier) & (table_size() - 1);
+    const auto& candidate = table->slots[slot];
+
+    if (table->used[slot] && candidate.spelling == identifier) {
+        return candidate;
+    }
+    return {};
+}
+
+static_assert(lookup("fn").keyword == Keyword::Fn);
+static_assert(lookup("puts").builtin == Builtin::Puts);
+static_assert(lookup("main").keyword == Keyword::None);
+
+} // namespace keywords
+
+#endif // KEYWORDS_HPP
@@ -1,18 +1,83 @@
 #include "Lexer.hpp"
+#include "Keywords.hpp"
+#include "LexerTables.hpp"
+#include "Simd.hpp"
 
 auto Token::create(
-  const std::string& lexeme,
-  const TokenType    type,
-  const Span&        span
+  const TokenType type,
+  const Span&     span,
+  const Keyword   keyword,
+  const Builtin   builtin
 ) -> Token {
-    return { lexeme, type, span };
+    return { type, span, keyword, builtin };
 }
 
-auto Token::lexeme() const -> std::string { return this->m_lexeme; }
+auto Token::lexeme(const Compiler& compiler) const -> std::string_view {
+    const auto source = compiler.files().contents(this->m_file_id);
+
+    // The span of a string literal includes its delimiters, the lexeme not
+    if (this->m_type == TokenType::DoubleQuotedString) {
+        return source.substr(this->m_offset + 1, this->m_length - 2);
+    }
+    return source.substr(this->m_offset, this->m_length);
+}
 
 auto Token::type() const -> TokenType { return this->m_type; }
 
-auto Token::span() const -> Span { return this->m_span; }
+auto Token::create_number(
+  const Span&         span,
+  const std::uint64_t value,
+  Compiler&           compiler
+) -> std::optional<Token> {
+    auto token = Token(TokenType::Number, span, Keyword::None, Builtin::None);
+    if (value < Token::inline_limit) {
+        token.set_payload(static_cast<std::uint32_t>(value));
+        return token;
+    }
+
+    const auto slot = compiler.add_number(value);
+    if (slot >= Token::inline_limit) { return std::nullopt; }
+    token.set_payload(Token::inline_limit + static_cast<std::uint32_t>(slot));
+    return token;
+}
+
+auto Token::keyword() const -> Keyword {
+    if (this->m_type != TokenType::KeywordOrIdentifier) {
+        return Keyword::None;
+    }
+    return static_cast<Keyword>(this->m_payload[0]);
+}
+
+auto Token::builtin() const -> Builtin {
+    if (this->m_type != TokenType::KeywordOrIdentifier) {
+        return Builtin::None;
+    }
+    return static_cast<Builtin>(this->m_payload[1]);
+}
+
+auto Token::value(const Compiler& compiler) const -> std::uint64_t {
+    const auto payload = this->payload();
+    if (payload < Token::inline_limit) { return payload; }
+    return compiler.number(payload - Token::inline_limit);
+}
+
+auto Token::payload() const -> std::uint32_t {
+    return static_cast<std::uint32_t>(this->m_payload[0])
+           | (static_cast<std::uint32_t>(this->m_payload[1]) << 8U)
+           | (static_cast<std::uint32_t>(this->m_payload[2]) << 16U);
+}
+
+void Token::set_payload(const std::uint32_t payload) {
+    this->m_payload = { static_cast<std::uint8_t>(payload),
+                        static_cast<std::uint8_t>(payload >> 8U),
+                        static_cast<std::uint8_t>(payload >> 16U) };
+}
+
+auto Token::span() const -> Span {
+    return Span::create(
+      this->m_file_id, this->m_offset, this->m_offset + this->m_length - 1
+    );
+}
 
 auto Token::type_to_string() const -> std::string {
     static_assert(
@@ -58,253 +123,469 @@ auto Token::type_to_string() const -> std::string {
 }
 
 auto Token::is_keyword() const -> bool {
-    constexpr static std::array<std::string_view, 3> keywords = { "fn",
-                                                                  "begin",
-                                                                  "end" };
-    return std::ranges::find(keywords, this->m_lexeme) != keywords.end();
+    return this->keyword() != Keyword::None;
 }
 
-Token::Token(std::string lexeme, const TokenType type, const Span& span)
-  : m_lexeme{ std::move(lexeme) },
+Token::Token(
+  const TokenType type,
+  const Span&     span,
+  const Keyword   keyword,
+  const Builtin   builtin
+)
+  : m_offset{ static_cast<std::uint32_t>(span.start()) },
+    m_length{ static_cast<std::uint32_t>(span.end() - span.start() + 1) },
+    m_file_id{ span.file_id() },
     m_type{ type },
-    m_span{ span } {}
+    m_payload{ std::to_underlying(keyword), std::to_underlying(builtin), 0 } {}
+
+auto Lexer::lex(
+  const std::shared_ptr<Compiler>& compiler,
+  const std::size_t                jobs
+) -> std::expected<std::vector<Token>, LexError> {
+    const auto source = compiler->file_contents();
+    if (source.empty()) { return std::unexpected(LexError::EmptySource); }
+
+    // Below this size spawning threads costs more than it saves
+    constexpr std::size_t min_chunk_size  = 256UL * 1024UL;
+    // More chunks than threads, so a dense chunk does not stall the others
+    constexpr std::size_t chunks_per_job  = 4;
+    const std::size_t     max_chunk_count = source.size() / min_chunk_size;
+
+    const auto boundaries = Lexer::find_chunk_boundaries(
+      source,
+      jobs > 1 ? std::min(jobs * chunks_per_job, max_chunk_count) : 1
+    );
+    const auto chunk_count = boundaries.size() - 1;
+
+    struct Chunk {
+        std::expected<std::vector<Token>, LexError> tokens;
+        std::vector<RackError>                      errors;
+    };
+    std::vector<Chunk> chunks(chunk_count);
+
+    const auto lex_chunk = [&](const std::size_t idx) {
+        Lexer lexer(compiler, boundaries[idx], boundaries[idx + 1]);
+        chunks[idx].tokens = lexer.lex_range();
+        chunks[idx].errors = std::move(lexer.m_errors);
+    };
 
-auto Lexer::lex(const std::shared_ptr<Compiler>& compiler)
-  -> std::expected<std::vector<Token>, LexError> {
-    if (compiler->file_contents().empty()) {
-        return std::unexpected(LexError::EmptySource);
+    if (chunk_count == 1) {
+        lex_chunk(0);
+    } else {
+        std::atomic<std::size_t> next_chunk = 0;
+
+        const auto worker_count = std::min(jobs, chunk_count);
+
+        std::vector<std::jthread> workers;
+        workers.reserve(worker_count);
+        for (std::size_t worker = 0; worker < worker_count; ++worker) {
+            workers.emplace_back([&]() {
+                for (auto idx = next_chunk++; idx < chunk_count;
+                     idx      = next_chunk++) {
+                    lex_chunk(idx);
+                }
+            });
+        }
     }
 
-    std::vector<Token> tokens;
-    Lexer              lexer(compiler);
+    // Stitch the chunks back together in source order. Spans are offsets
+    // into the whole buffer already, so they need no adjustment. Like the
+    // sequential lexer, stop at the first chunk that failed.
+    std::size_t token_count = 0;
+    for (auto& chunk : chunks) {
+        if (!chunk.tokens.has_value()) {
+            for (auto& error : chunk.errors) {
+                compiler->push_error(std::move(error));
+            }
+            return std::unexpected(chunk.tokens.error());
+        }
+        token_count += chunk.tokens->size();
+    }
 
-    auto&& token = lexer.next();
-    while (token.error() != LexError::Eof) {
-        if (!token.has_value()) { return std::unexpected(token.error()); }
+    if (chunk_count == 1) { return std::move(chunks.front().tokens); }
 
-        tokens.push_back(token.value());
-        token = lexer.next();
+    std::vector<Token> tokens;
+    tokens.reserve(token_count);
+    for (const auto& chunk : chunks) {
+        tokens.insert(tokens.end(), chunk.tokens->begin(), chunk.tokens->end());
     }
 
     return tokens;
 }
 
-Lexer::Lexer(const std::shared_ptr<Compiler>& compiler)
-  : m_compiler{ compiler },
-    m_source{ compiler->file_contents() },
-    m_cursor{ 0 } {}
+auto Lexer::find_chunk_boundaries(
+  const std::string_view source,
+  const std::size_t      chunk_count
+) -> std::vector<std::size_t> {
+    std::vector<std::size_t> boundaries = { 0 };
 
-auto Lexer::span(const std::size_t start, const std::size_t end) const -> Span {
-    return Span::create(this->m_compiler->target(), start, end);
-}
+    const char* const begin     = source.data();
+    const char* const end       = begin + source.size();
+    const char*       cursor    = begin;
+    bool              in_string = false;
 
-void Lexer::error(const std::string& message, const Span& span) {
-    this->m_compiler->push_error(RackError{ message, span });
+    const auto find = [&](const char* from, const char* to, const char ch) {
+        const auto* found = static_cast<const char*>(
+          std::memchr(from, ch, static_cast<std::size_t>(to - from))
+        );
+        return found != nullptr ? found : to;
+    };
+
+    // Every double quote outside of a literal opens one, so replaying the
+    // quotes and escapes is enough to know whether a newline is a safe
+    // place to split: no token other than a string literal spans one.
+    for (std::size_t chunk = 1; chunk < chunk_count && cursor < end; ++chunk) {
+        const char* const target = begin + chunk * source.size() / chunk_count;
+
+        while (cursor < end) {
+            if (in_string) {
+                cursor = simd::skip_string_contents(cursor, end);
+                if (cursor == end) { break; }
+
+                if (*cursor == '"') { in_string = false; }
+                // Also skip the escaped character, if any
+                if (*cursor == '\\' && end - cursor > 1) { ++cursor; }
+                ++cursor;
+                continue;
+            }
+
+            const char* const newline =
+              find(std::max(cursor, target), end, '\n');
+            const char* const quote   = find(cursor, newline, '"');
+            if (quote != newline) {
+                cursor    = quote + 1;
+                in_string = true;
+                continue;
+            }
+
+            cursor = newline == end ? end : newline + 1;
+            if (cursor != end) {
+                boundaries.push_back(static_cast<std::size_t>(cursor - begin));
+            }
+            break;
+        }
+    }
+
+    boundaries.push_back(source.size());
+    return boundaries;
 }
 
-auto Lexer::eof() const -> bool {
-    return this->m_cursor >= this->m_source.size();
+Lexer::Lexer(
+  const std::shared_ptr<Compiler>& compiler,
+  const std::size_t                begin,
+  const std::size_t                end
+)
+  : m_compiler{ compiler },
+    m_file_id{ compiler->file_id() },
+    m_begin{ compiler->file_contents().data() },
+    m_cursor{ this->m_begin + begin },
+    m_end{ this->m_begin + end } {}
+
+auto Lexer::lex_range() -> std::expected<std::vector<Token>, LexError> {
+    std::vector<Token> tokens;
+
+    // Rough guess of the token density, avoids most regrowth on big inputs
+    tokens.reserve(static_cast<std::size_t>(this->m_end - this->m_cursor) / 8);
+
+    while (true) {
+        auto token = this->next();
+        if (!token.has_value()) {
+            if (token.error() == LexError::Eof) { break; }
+            return std::unexpected(token.error());
+        }
+
+        tokens.push_back(token.value());
+    }
+
+    return tokens;
 }
 
-auto Lexer::peek() const -> std::expected<char, LexError> {
-    if (this->eof()) { return std::unexpected(LexError::Eof); }
-    return this->m_source[this->m_cursor];
+auto Lexer::span(const char* first, const char* last) const -> Span {
+    return Span::create(
+      this->m_file_id,
+      static_cast<std::size_t>(first - this->m_begin),
+      static_cast<std::size_t>(last - this->m_begin)
+    );
 }
 
-auto Lexer::peek_ahead(const std::size_t offset) const
-  -> std::expected<char, LexError> {
-    if (this->m_cursor + offset >= this->m_source.size()) {
-        return std::unexpected(LexError::Eof);
-    }
-    return this->m_source[m_cursor];
+void Lexer::error(const std::string& message, const Span& span) {
+    this->m_errors.push_back(RackError{ message, span });
 }
 
 auto Lexer::next() -> std::expected<Token, LexError> {
-    while (true) {
-        const auto ch = this->peek();
+    using lexer_tables::CharClass;
+    using lexer_tables::State;
 
-        if (ch.has_value() && (bool)std::isspace(ch.value())) {
-            ++this->m_cursor;
-        } else if (!ch.has_value()) {
-            return std::unexpected(ch.error());
-        } else {
-            break;
-        }
+    const char* cursor = this->m_cursor;
+    if (lexer_tables::class_of(*cursor) == CharClass::Whitespace) {
+        cursor = simd::skip_whitespace(cursor + 1, this->m_end);
     }
 
-    const auto current_char = this->peek();
-    if (!current_char.has_value()) {
-        return std::unexpected(current_char.error());
+    if (cursor >= this->m_end) {
+        this->m_cursor = cursor;
+        return std::unexpected(LexError::Eof);
     }
 
-    const auto start = this->m_cursor;
-    switch (current_char.value()) {
-        case ':': {
-            return Token::create(
-              ":", TokenType::Colon, this->span(start, this->m_cursor++)
-            );
-        }
-        case ',': {
-            return Token::create(
-              ",", TokenType::Comma, this->span(start, this->m_cursor++)
-            );
-        }
-        case '*': {
-            return Token::create(
-              "*", TokenType::Asterisk, this->span(start, this->m_cursor++)
-            );
-        }
-        case '-': {
-            return this->lex_minus();
+    // Run the DFA for as long as there is a transition (maximal munch)
+    const char* start = cursor;
+    auto        state = State::Start;
+    while (true) {
+        // Most runs are only a few bytes long, so they are walked inline and
+        // only handed to the vectorised kernels once they get longer
+        std::size_t run = 0;
+        while (run < 8 && lexer_tables::loops(state, *cursor)) {
+            ++cursor;
+            ++run;
         }
-        case '"': {
-            return this->lex_quoted_string();
+
+        if (run == 8) {
+            switch (state) {
+                case State::Identifier:
+                case State::Number: {
+                    cursor = simd::skip_identifier(cursor, this->m_end);
+                    break;
+                }
+                case State::String: {
+                    cursor = simd::skip_string_contents(cursor, this->m_end);
+                    break;
+                }
+                default: {
+                    while (lexer_tables::loops(state, *cursor)) { ++cursor; }
+                }
+            }
         }
-        default: {
-            return this->lex_keyword_identifier_or_number();
+
+        auto char_class = lexer_tables::class_of(*cursor);
+        auto next_state = lexer_tables::transition(state, char_class);
+
+        if (next_state == State::Start) {
+            // A '\0' before the end of the buffer is just a regular byte
+            if (char_class != CharClass::Sentinel || cursor >= this->m_end) {
+                break;
+            }
+            next_state = lexer_tables::transition(state, CharClass::Other);
+            if (next_state == State::Start) { break; }
         }
-    }
-}
 
-auto Lexer::lex_keyword_identifier_or_number()
-  -> std::expected<Token, LexError> {
-    const auto start = this->m_cursor;
-    if (this->eof()) {
-        this->error("unexpected eof", this->span(start, start));
-        return std::unexpected(LexError::Eof);
+        state = next_state;
+        ++cursor;
     }
 
-    // This should be guaranteed as we have just checked for eof
-    auto       current_char = this->peek().value();
-    const auto is_valid_char_for_identifier_or_keyword =
-      [](const auto ch) -> bool { return std::isalnum(ch) != 0 || ch == '_'; };
-
-    if (std::isdigit(current_char) != 0) {
-        return this->lex_number();
-    } else if (std::isalpha(current_char) != 0 || current_char == '_') {
-        std::stringstream ss;
-        while (!this->eof()
-               && is_valid_char_for_identifier_or_keyword(current_char)) {
-            ss << current_char;
-            ++this->m_cursor;
-            current_char = this->peek().value();
+    if (const auto type = lexer_tables::accepts(state); type != TokenType::Max) {
+        this->m_cursor = cursor;
+
+        if (type == TokenType::Number) { return this->lex_number(start, cursor); }
+
+        if (type == TokenType::KeywordOrIdentifier) {
+            const auto word = keywords::lookup(
+              std::string_view(start, static_cast<std::size_t>(cursor - start))
+            );
+            return Token::create(
+              type, this->span(start, cursor - 1), word.keyword, word.builtin
+            );
         }
+        return Token::create(type, this->span(start, cursor - 1));
+    }
 
-        return Token::create(
-          ss.str(),
-          TokenType::KeywordOrIdentifier,
-          this->span(start, this->m_cursor - 1)
+    if (state == State::String || state == State::StringEscape) {
+        this->m_cursor = cursor;
+        this->error(
+          "unexpected eof: unterminated string literal",
+          this->span(start, cursor - 1)
         );
+        return std::unexpected(LexError::UnterminatedString);
     }
 
+    this->m_cursor = start + 1;
     this->error(
-      fmt::format("unexpected character {}", current_char),
-      this->span(start, ++this->m_cursor)
+      fmt::format("unexpected character {}", *start), this->span(start, start)
     );
     return std::unexpected(LexError::UnexpectedCharacter);
 }
 
-auto Lexer::lex_number() -> std::expected<Token, LexError> {
-    const auto start = this->m_cursor;
-    if (this->eof()) {
-        this->error("unexpected eof", this->span(start, start));
-        return std::unexpected(LexError::Eof);
+auto Lexer::lex_number(const char* start, const char* end)
+  -> std::expected<Token, LexError> {
+    const auto literal =
+      std::string_view(start, static_cast<std::size_t>(end - start));
+
+    int              base   = 10;
+    std::string_view kind   = "decimal";
+    std::string_view digits = literal;
+    if (literal.size() >= 2 && literal[0] == '0') {
+        switch (literal[1]) {
+            case 'x':
+            case 'X': {
+                base = 16;
+                kind = "hexadecimal";
+                break;
+            }
+            case 'o':
+            case 'O': {
+                base = 8;
+                kind = "octal";
+                break;
+            }
+            case 'b':
+            case 'B': {
+                base = 2;
+                kind = "binary";
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+        if (base != 10) { digits.remove_prefix(2); }
     }
 
-    // TODO: Add support for hex, octal and binary
-    constexpr std::string_view valid_digits   = "0123456789";
-    const auto                 is_valid_digit = [&](const auto ch) -> bool {
-        return valid_digits.find(ch) != std::string::npos;
+    const auto digit_value = [](const char ch) -> int {
+        if (ch >= '0' && ch <= '9') { return ch - '0'; }
+        if (ch >= 'a' && ch <= 'z') { return ch - 'a' + 10; }
+        if (ch >= 'A' && ch <= 'Z') { return ch - 'A' + 10; }
+        return std::numeric_limits<int>::max();
     };
 
-    std::stringstream number;
+    // Validate every digit and drop separators and leading zeros, what is left
+    // never needs more than 64 digits unless the value overflows anyway
+    std::array<char, 64> buffer{};
+    std::size_t          size       = 0;
+    bool                 has_digits = false;
+    bool                 overflow   = false;
+    for (const char& ch : digits) {
+        if (ch == '_') { continue; }
+
+        if (digit_value(ch) >= base) {
+            this->error(
+              fmt::format("invalid digit '{}' in {} literal", ch, kind),
+              this->span(&ch, &ch)
+            );
+            return std::unexpected(LexError::InvalidNumberLiteral);
+        }
 
-    // TODO: Handle floating point numbers, digit separators, prefix literals,
-    //       suffix literals
-    auto current_char = this->peek().value();
-    while (!this->eof() && is_valid_digit(current_char)) {
-        current_char = this->peek().value();
-        number << current_char;
-        ++this->m_cursor;
+        has_digits = true;
+        if (size == 0 && ch == '0') { continue; }
+        if (size == buffer.size()) {
+            overflow = true;
+            continue;
+        }
+        buffer[size++] = ch;
     }
 
-    return Token::create(
-      number.str(), TokenType::Number, this->span(start, this->m_cursor - 1)
-    );
-}
-
-auto Lexer::lex_minus() -> std::expected<Token, LexError> {
-    const auto start = this->m_cursor;
-    ++this->m_cursor;
-    const auto next_char = this->peek();
-
-    if (next_char.has_value()) {
-        switch (next_char.value()) {
-            case '-': {
-                return Token::create(
-                  "--",
-                  TokenType::MinusMinus,
-                  this->span(start, this->m_cursor++)
-                );
-            }
-            case '>': {
-                return Token::create(
-                  "->", TokenType::Arrow, this->span(start, this->m_cursor++)
-                );
-            }
-            default: {
-                this->error(
-                  fmt::format(
-                    "unexpected char: {} after '-' ", next_char.value()
-                  ),
-                  this->span(start, this->m_cursor++)
-                );
-                return std::unexpected(LexError::UnexpectedCharacter);
-            }
-        }
-    } else {
-        return Token::create(
-          "-", TokenType::Minus, this->span(start, this->m_cursor++)
+    if (!has_digits) {
+        this->error(
+          fmt::format("{} literal has no digits", kind),
+          this->span(start, end - 1)
         );
+        return std::unexpected(LexError::InvalidNumberLiteral);
     }
-}
 
-auto Lexer::lex_quoted_string() -> std::expected<Token, LexError> {
-    // Skip first double quote
-    const auto start = this->m_cursor;
-    ++this->m_cursor;
+    std::uint64_t value = 0;
+    if (!overflow && size != 0) {
+        const auto result =
+          std::from_chars(buffer.data(), buffer.data() + size, value, base);
+        overflow = result.ec == std::errc::result_out_of_range;
+    }
 
-    // This means the string literal is not terminated
-    if (this->eof()) {
+    if (overflow) {
         this->error(
-          "unexpected eof: unterminated string literal",
-          this->span(start, this->m_cursor)
+          fmt::format("integer literal {} does not fit in 64 bits", literal),
+          this->span(start, end - 1)
         );
-        return std::unexpected(LexError::Eof);
+        return std::unexpected(LexError::InvalidNumberLiteral);
     }
 
-    // This should be guaranteed as we have checked just above for eof
-    auto current_char = this->peek().value();
-    bool is_escaped   = false;
+    auto token = Token::create_number(
+      this->span(start, end - 1), value, *this->m_compiler
+    );
+    if (!token.has_value()) {
+        this->error(
+          "too many integer literals of 2^23 or more",
+          this->span(start, end - 1)
+        );
+        return std::unexpected(LexError::InvalidNumberLiteral);
+    }
+    return token.value();
+}
 
-    // TODO: Check against a proper delimiter, if we want to support for single
-    //       quoted strings
-    while (!this->eof() && (is_escaped || current_char != '"')) {
-        current_char = this->peek().value();
+auto TokenStream::create(const std::shared_ptr<Compiler>& compiler)
+  -> std::expected<TokenStream, LexError> {
+    const auto source = compiler->file_contents();
+    if (source.empty()) { return std::unexpected(LexError::EmptySource); }
 
-        if (current_char == '\r' || current_char == '\n') {
-            ++this->m_cursor;
-            continue;
-        }
+    return TokenStream(
+      compiler, Lexer(compiler, 0, source.size()), std::vector<Token>{}
+    );
+}
 
-        is_escaped = !is_escaped && current_char == '\\';
-        ++this->m_cursor;
-    }
+auto TokenStream::create(std::vector<Token> tokens) -> TokenStream {
+    return { nullptr, std::nullopt, std::move(tokens) };
+}
 
-    const auto quoted =
-      this->m_source.substr(start + 1, this->m_cursor - start - 2);
+TokenStream::TokenStream(
+  std::shared_ptr<Compiler> compiler,
+  std::optional<Lexer>      lexer,
+  std::vector<Token>        tokens
+)
+  : m_compiler{ std::move(compiler) },
+    m_lexer{ std::move(lexer) },
+    m_tokens{ std::move(tokens) } {}
 
-    return Token::create(
-      quoted, TokenType::DoubleQuotedString, this->span(start, this->m_cursor++)
+auto TokenStream::peek(const std::size_t offset)
+  -> std::expected<Token, LexError> {
+    FMT_ASSERT(
+      offset < TokenStream::lookahead,
+      "[INTERNAL ERROR] TokenStream::peek(): offset exceeds the lookahead"
     );
+
+    while (this->m_count <= offset && !this->m_status.has_value()) {
+        this->pull();
+    }
+
+    if (offset >= this->m_count) {
+        return std::unexpected(this->m_status.value());
+    }
+    return this->m_ring[(this->m_head + offset) & (lookahead - 1)].value();
+}
+
+void TokenStream::advance() {
+    if (this->m_count == 0) {
+        if (this->m_status.has_value()) { return; }
+        this->pull();
+        if (this->m_count == 0) { return; }
+    }
+
+    this->m_head = (this->m_head + 1) & (lookahead - 1);
+    --this->m_count;
+}
+
+auto TokenStream::error() const -> std::optional<LexError> {
+    if (this->m_status == LexError::Eof) { return std::nullopt; }
+    return this->m_status;
+}
+
+void TokenStream::pull() {
+    const auto slot = (this->m_head + this->m_count) & (lookahead - 1);
+
+    if (!this->m_lexer.has_value()) {
+        if (this->m_next_token == this->m_tokens.size()) {
+            this->m_status = LexError::Eof;
+            return;
+        }
+        this->m_ring[slot] = this->m_tokens[this->m_next_token++];
+        ++this->m_count;
+        return;
+    }
+
+    auto token = this->m_lexer->next();
+    if (!token.has_value()) {
+        this->m_status = token.error();
+        for (auto& error : this->m_lexer->m_errors) {
+            this->m_compiler->push_error(std::move(error));
+        }
+        this->m_lexer->m_errors.clear();
+        return;
+    }
+
+    this->m_ring[slot] = token.value();
+    ++this->m_count;
 }
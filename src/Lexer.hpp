@@ -5,12 +5,20 @@
 
 #include "Compiler.hpp"
 #include "Utility.hpp"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <charconv>
+#include <cstring>
 #include <cstdint>
 #include <expected>
 #include <fmt/format.h>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -18,10 +26,12 @@ enum class LexError : std::uint64_t {
     Eof = 0,
     EmptySource,
     UnexpectedCharacter,
+    UnterminatedString,
+    InvalidNumberLiteral,
     Max
 };
 
-enum class TokenType : std::uint64_t {
+enum class TokenType : std::uint8_t {
     Number = 0,
     Plus,
     KeywordOrIdentifier,
@@ -35,73 +45,196 @@ enum class TokenType : std::uint64_t {
     Max
 };
 
+/// Keyword a token spells, classified once by the lexer
+enum class Keyword : std::uint8_t {
+    None = 0,
+    Fn,
+    Begin,
+    End,
+    Max
+};
+
+/// Builtin function a token names, classified once by the lexer
+enum class Builtin : std::uint8_t {
+    None = 0,
+    Print,
+    Puts,
+    Max
+};
+
+/// A token is just a typed range of the source buffer: the lexeme and the
+/// file path are resolved through the Compiler when needed, which keeps the
+/// token array dense. Number tokens also carry their value, parsed once by
+/// the lexer: inline when it is small, in the Compiler otherwise.
 class Token {
   public:
-    [[nodiscard]] static auto
-      create(const std::string& lexeme, const TokenType type, const Span& span)
-        -> Token;
+    [[nodiscard]] static auto create(
+      const TokenType type,
+      const Span&     span,
+      const Keyword   keyword = Keyword::None,
+      const Builtin   builtin = Builtin::None
+    ) -> Token;
+    /// Nullopt once the Compiler cannot hold more wide values
+    [[nodiscard]] static auto create_number(
+      const Span&         span,
+      const std::uint64_t value,
+      Compiler&           compiler
+    ) -> std::optional<Token>;
 
-    [[nodiscard]] auto lexeme() const -> std::string;
+    [[nodiscard]] auto lexeme(const Compiler& compiler) const
+      -> std::string_view;
     [[nodiscard]] auto type() const -> TokenType;
     [[nodiscard]] auto span() const -> Span;
+    [[nodiscard]] auto keyword() const -> Keyword;
+    [[nodiscard]] auto builtin() const -> Builtin;
+    [[nodiscard]] auto value(const Compiler& compiler) const -> std::uint64_t;
 
     [[nodiscard]] auto type_to_string() const -> std::string;
     [[nodiscard]] auto is_keyword() const -> bool;
 
   private:
-    Token(std::string lexeme, const TokenType type, const Span& span);
+    // Number values below this are kept in the token
+    static constexpr std::uint32_t inline_limit = 1U << 23U;
+
+    Token(
+      const TokenType type,
+      const Span&     span,
+      const Keyword   keyword,
+      const Builtin   builtin
+    );
 
-    std::string m_lexeme;
-    TokenType   m_type;
-    Span        m_span;
+    [[nodiscard]] auto payload() const -> std::uint32_t;
+    void               set_payload(const std::uint32_t payload);
+
+    std::uint32_t               m_offset;
+    std::uint32_t               m_length;
+    std::uint32_t               m_file_id;
+    TokenType                   m_type;
+    // 24 bits depending on the type. Identifiers: their Keyword then their
+    // Builtin, resolved once by the lexer so later stages never compare
+    // lexemes. Numbers: the value if below inline_limit, or else
+    // inline_limit plus its slot in Compiler::add_number().
+    std::array<std::uint8_t, 3> m_payload{};
 };
 
+static_assert(
+  sizeof(Token) <= 16,
+  "[INTERNAL ERROR] Token is expected to fit in 16 bytes"
+);
+
 class Lexer {
   public:
-    [[nodiscard]] static auto lex(const std::shared_ptr<Compiler>& compiler)
-      -> std::expected<std::vector<Token>, LexError>;
+    /// Lexes the whole source. With jobs > 1 large sources are split at
+    /// newlines outside of string literals and the chunks are lexed in
+    /// parallel, the result is the same as the sequential lexer's.
+    [[nodiscard]] static auto lex(
+      const std::shared_ptr<Compiler>& compiler,
+      const std::size_t                jobs = 1
+    ) -> std::expected<std::vector<Token>, LexError>;
 
   private:
-    explicit Lexer(const std::shared_ptr<Compiler>& compiler);
+    friend class TokenStream;
+
+    Lexer(
+      const std::shared_ptr<Compiler>& compiler,
+      const std::size_t                begin,
+      const std::size_t                end
+    );
+
+    [[nodiscard]] static auto find_chunk_boundaries(
+      const std::string_view source,
+      const std::size_t      chunk_count
+    ) -> std::vector<std::size_t>;
+
+    [[nodiscard]] auto lex_range() -> std::expected<std::vector<Token>, LexError>;
 
     [[nodiscard]] auto
-      span(const std::size_t start, const std::size_t end) const -> Span;
+      span(const char* first, const char* last) const -> Span;
 
     void error(const std::string& message, const Span& span);
 
-    [[nodiscard]] auto eof() const -> bool;
-    [[nodiscard]] auto peek() const -> std::expected<char, LexError>;
-    [[nodiscard]] auto peek_ahead(const std::size_t offset) const
-      -> std::expected<char, LexError>;
     [[nodiscard]] auto next() -> std::expected<Token, LexError>;
-
-    [[nodiscard]] auto lex_keyword_identifier_or_number()
+    [[nodiscard]] auto lex_number(const char* start, const char* end)
       -> std::expected<Token, LexError>;
-    [[nodiscard]] auto lex_number() -> std::expected<Token, LexError>;
-    [[nodiscard]] auto lex_minus() -> std::expected<Token, LexError>;
-    [[nodiscard]] auto lex_quoted_string() -> std::expected<Token, LexError>;
 
     std::shared_ptr<Compiler> m_compiler;
-    std::string               m_source;
-    std::size_t               m_cursor;
+    // Errors are only handed to the Compiler once lexing is done, so chunks
+    // can be lexed on several threads
+    std::vector<RackError>    m_errors;
+    std::uint32_t             m_file_id;
+    // The source is followed by a '\0' sentinel (see dts::MappedFile), so
+    // the scanning loops only need to compare against m_end on a '\0'
+    const char*               m_begin;
+    const char*               m_cursor;
+    const char*               m_end;
+};
+
+/// Pull based token source the assembler consumes.
+///
+/// Tokens are lexed on demand into a small ring buffer, so lexing and code
+/// generation interleave and only `lookahead` tokens are alive at any time.
+/// It can also replay an already lexed vector, for the parallel lexer and
+/// for token dumps. Once the lexer stops, every further peek returns the
+/// reason: LexError::Eof at the end of the source, or the lex error whose
+/// diagnostics have been handed to the Compiler.
+class TokenStream {
+  public:
+    static constexpr std::size_t lookahead = 4;
+
+    [[nodiscard]] static auto create(const std::shared_ptr<Compiler>& compiler)
+      -> std::expected<TokenStream, LexError>;
+    [[nodiscard]] static auto create(std::vector<Token> tokens) -> TokenStream;
+
+    /// Token `offset` positions ahead of the cursor, offset < lookahead
+    [[nodiscard]] auto peek(const std::size_t offset = 0)
+      -> std::expected<Token, LexError>;
+    void advance();
+
+    /// Set once the lexer failed, Eof is not an error
+    [[nodiscard]] auto error() const -> std::optional<LexError>;
+
+  private:
+    TokenStream(
+      std::shared_ptr<Compiler> compiler,
+      std::optional<Lexer>      lexer,
+      std::vector<Token>        tokens
+    );
+
+    void pull();
+
+    static_assert(
+      (lookahead & (lookahead - 1)) == 0,
+      "[INTERNAL ERROR] TokenStream::lookahead must be a power of two"
+    );
+
+    std::shared_ptr<Compiler>                   m_compiler;
+    std::optional<Lexer>                        m_lexer;
+    // Replayed instead of m_lexer when the source was lexed up front
+    std::vector<Token>                          m_tokens;
+    std::size_t                                 m_next_token = 0;
+    std::array<std::optional<Token>, lookahead> m_ring;
+    std::size_t                                 m_head  = 0;
+    std::size_t                                 m_count = 0;
+    // Why the lexer stopped, once it did
+    std::optional<LexError>                     m_status;
 };
 
 /// {fmt} Custom Formatters
 template<>
-struct fmt::formatter<Token> {
+struct fmt::formatter<Located<Token>> {
     template<typename ParseContext>
     constexpr auto parse(ParseContext& ctx) {
         return ctx.begin();
     }
 
     template<typename FormatContext>
-    auto format(const Token& token, FormatContext& ctx) {
+    auto format(const Located<Token>& token, FormatContext& ctx) {
         return fmt::format_to(
           ctx.out(),
           "Token {{ lexeme: {}, type: {}, span: {} }}",
-          token.lexeme(),
-          token.type_to_string(),
-          token.span()
+          token.value.lexeme(token.compiler),
+          token.value.type_to_string(),
+          Located<Span>{ token.compiler, token.value.span() }
         );
     }
 };
@@ -116,7 +249,7 @@ struct fmt::formatter<LexError> {
     template<typename FormatContext>
     auto format(const LexError& error, FormatContext& ctx) {
         static_assert(
-          std::to_underlying(LexError::Max) == 3,
+          std::to_underlying(LexError::Max) == 5,
           "[INTERNAL ERROR] fmt::formatter<LexError> requires to handle all "
           "enum variants"
         );
@@ -132,6 +265,12 @@ struct fmt::formatter<LexError> {
                 case LexError::UnexpectedCharacter: {
                     return "LexError::UnexpectedCharacter";
                 }
+                case LexError::UnterminatedString: {
+                    return "LexError::UnterminatedString";
+                }
+                case LexError::InvalidNumberLiteral: {
+                    return "LexError::InvalidNumberLiteral";
+                }
                 default: {
                     return "Unknown Lex Error";
                 }
@@ -0,0 +1,200 @@
+#ifndef LEXER_TABLES_HPP
+#define LEXER_TABLES_HPP
+
+#include "Lexer.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+/// Compile-time generated tables driving the lexer DFA.
+///
+/// Every byte is first mapped to a character class through a 256-entry
+/// table, then the DFA moves with a single lookup in the transition table.
+/// The states for fixed-spelling tokens are generated from `punctuators`,
+/// so adding a token there is enough to have it lexed.
+namespace lexer_tables {
+
+struct Punctuator {
+    std::string_view spelling;
+    TokenType        type;
+};
+
+inline constexpr std::array punctuators = {
+    Punctuator{ ":", TokenType::Colon },
+    Punctuator{ ",", TokenType::Comma },
+    Punctuator{ "*", TokenType::Asterisk },
+    Punctuator{ "+", TokenType::Plus },
+    Punctuator{ "-", TokenType::Minus },
+    Punctuator{ "--", TokenType::MinusMinus },
+    Punctuator{ "->", TokenType::Arrow },
+};
+
+enum class CharClass : std::uint8_t {
+    Other = 0,
+    Whitespace,
+    Digit,
+    IdentifierStart,
+    DoubleQuote,
+    Backslash,
+    Sentinel,
+    // Every character used by a punctuator gets its own class from here on
+    FirstPunctuator,
+};
+
+// State 0 doubles as "no transition": nothing ever moves back to Start
+enum class State : std::uint8_t {
+    Start = 0,
+    Identifier,
+    Number,
+    String,
+    StringEscape,
+    StringEnd,
+    // Punctuator trie states are allocated from here on
+    FirstPunctuator,
+};
+
+inline constexpr std::size_t max_classes = 16;
+inline constexpr std::size_t max_states  = 32;
+
+struct Tables {
+    std::array<CharClass, 256>                             char_class{};
+    std::array<std::array<State, max_classes>, max_states> transitions{};
+    std::array<TokenType, max_states>                      accepts{};
+    // Bytes on which a state transitions to itself, lets the lexer skip
+    // identifier bodies or string contents without walking the DFA
+    std::array<std::array<bool, 256>, max_states>          self_loops{};
+    std::size_t                                            class_count{};
+    std::size_t                                            state_count{};
+};
+
+[[nodiscard]] constexpr auto build_tables() -> Tables {
+    Tables tables;
+
+    const auto set =
+      [&](const State from, const CharClass with, const State to) {
+          tables.transitions[std::to_underlying(from)]
+                            [std::to_underlying(with)] = to;
+      };
+
+    // Character classes, independent of the current locale
+    for (const unsigned char ch : std::string_view(" \t\n\v\f\r")) {
+        tables.char_class[ch] = CharClass::Whitespace;
+    }
+    for (unsigned char ch = '0'; ch <= '9'; ++ch) {
+        tables.char_class[ch] = CharClass::Digit;
+    }
+    for (unsigned char ch = 'a'; ch <= 'z'; ++ch) {
+        tables.char_class[ch] = CharClass::IdentifierStart;
+    }
+    for (unsigned char ch = 'A'; ch <= 'Z'; ++ch) {
+        tables.char_class[ch] = CharClass::IdentifierStart;
+    }
+    tables.char_class['_']  = CharClass::IdentifierStart;
+    tables.char_class['"']  = CharClass::DoubleQuote;
+    tables.char_class['\\'] = CharClass::Backslash;
+    tables.char_class['\0'] = CharClass::Sentinel;
+
+    tables.class_count = std::to_underlying(CharClass::FirstPunctuator);
+    for (const auto& punctuator : punctuators) {
+        for (const unsigned char ch : punctuator.spelling) {
+            if (tables.char_class[ch] == CharClass::Other) {
+                tables.char_class[ch] =
+                  static_cast<CharClass>(tables.class_count++);
+            }
+        }
+    }
+
+    for (auto& accept : tables.accepts) { accept = TokenType::Max; }
+
+    // Identifiers: [A-Za-z_][A-Za-z0-9_]*
+    set(State::Start, CharClass::IdentifierStart, State::Identifier);
+    set(State::Identifier, CharClass::IdentifierStart, State::Identifier);
+    set(State::Identifier, CharClass::Digit, State::Identifier);
+    tables.accepts[std::to_underlying(State::Identifier)] =
+      TokenType::KeywordOrIdentifier;
+
+    // Numbers: [0-9][A-Za-z0-9_]*, prefixes, separators and digits are
+    // validated by the lexer once the whole literal is known
+    set(State::Start, CharClass::Digit, State::Number);
+    set(State::Number, CharClass::Digit, State::Number);
+    set(State::Number, CharClass::IdentifierStart, State::Number);
+    tables.accepts[std::to_underlying(State::Number)] = TokenType::Number;
+
+    // String literals: anything up to an unescaped double quote
+    set(State::Start, CharClass::DoubleQuote, State::String);
+    for (std::size_t cls = 0; cls < tables.class_count; ++cls) {
+        const auto with = static_cast<CharClass>(cls);
+        if (with == CharClass::Sentinel) { continue; }
+        set(State::StringEscape, with, State::String);
+        if (with != CharClass::DoubleQuote && with != CharClass::Backslash) {
+            set(State::String, with, State::String);
+        }
+    }
+    set(State::String, CharClass::Backslash, State::StringEscape);
+    set(State::String, CharClass::DoubleQuote, State::StringEnd);
+    tables.accepts[std::to_underlying(State::StringEnd)] =
+      TokenType::DoubleQuotedString;
+
+    // Punctuators: a trie rooted at Start
+    tables.state_count = std::to_underlying(State::FirstPunctuator);
+    for (const auto& punctuator : punctuators) {
+        auto state = State::Start;
+        for (const unsigned char ch : punctuator.spelling) {
+            auto& next = tables.transitions[std::to_underlying(state)]
+                                           [std::to_underlying(
+                                             tables.char_class[ch]
+                                           )];
+            if (next == State::Start) {
+                next = static_cast<State>(tables.state_count++);
+            }
+            state = next;
+        }
+        tables.accepts[std::to_underlying(state)] = punctuator.type;
+    }
+
+    for (std::size_t state = 1; state < tables.state_count; ++state) {
+        for (std::size_t ch = 0; ch < 256; ++ch) {
+            const auto with = std::to_underlying(tables.char_class[ch]);
+            tables.self_loops[state][ch] =
+              std::to_underlying(tables.transitions[state][with]) == state;
+        }
+    }
+
+    return tables;
+}
+
+inline constexpr Tables tables = build_tables();
+
+static_assert(
+  tables.class_count <= max_classes,
+  "[INTERNAL ERROR] lexer_tables: too many character classes"
+);
+static_assert(
+  tables.state_count <= max_states,
+  "[INTERNAL ERROR] lexer_tables: too many lexer states"
+);
+
+[[nodiscard]] constexpr auto class_of(const char ch) -> CharClass {
+    return tables.char_class[static_cast<unsigned char>(ch)];
+}
+
+[[nodiscard]] constexpr auto transition(const State from, const CharClass with)
+  -> State {
+    return tables.transitions[std::to_underlying(from)]
+                             [std::to_underlying(with)];
+}
+
+[[nodiscard]] constexpr auto loops(const State state, const char ch) -> bool {
+    return tables.self_loops[std::to_underlying(state)]
+                            [static_cast<unsigned char>(ch)];
+}
+
+[[nodiscard]] constexpr auto accepts(const State state) -> TokenType {
+    return tables.accepts[std::to_underlying(state)];
+}
+
+} // namespace lexer_tables
+
+#endif // LEXER_TABLES_HPP
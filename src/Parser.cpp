@@ -0,0 +1,340 @@
+#include "Parser.hpp"
+
+auto Parser::parse(
+  const std::shared_ptr<Compiler>& compiler,
+  TokenStream                      tokens
+) -> std::expected<ast::Program, ParseError> {
+    Parser parser(compiler, std::move(tokens));
+
+    while (true) {
+        const auto result = parser.next();
+        if (!result.has_value()) {
+            if (result.error() == ParseError::Eof) { break; }
+            return std::unexpected(result.error());
+        }
+    }
+
+    return std::move(parser.m_program);
+}
+
+Parser::Parser(const std::shared_ptr<Compiler>& compiler, TokenStream tokens)
+  : m_compiler{ compiler },
+    m_tokens{ std::move(tokens) },
+    m_current{ Parser::read(this->m_tokens) } {}
+
+void Parser::error(const std::string& message, const Span& span) {
+    // Anything reported once the lexer failed would only be a consequence of
+    // the lex error, which is already in the Compiler
+    if (this->m_tokens.error().has_value()) { return; }
+    this->m_compiler->push_error(RackError{ message, span });
+}
+
+auto Parser::read(TokenStream& tokens) -> std::expected<Token, ParseError> {
+    const auto token = tokens.peek();
+    if (!token.has_value()) {
+        return std::unexpected(
+          token.error() == LexError::Eof ? ParseError::Eof
+                                         : ParseError::LexFailure
+        );
+    }
+    return token.value();
+}
+
+auto Parser::peek() const -> const std::expected<Token, ParseError>& {
+    return this->m_current;
+}
+
+void Parser::advance() {
+    this->m_tokens.advance();
+    this->m_current = Parser::read(this->m_tokens);
+}
+
+auto Parser::next() -> std::expected<void, ParseError> {
+    const auto& current_token = this->peek();
+    if (!current_token.has_value()) {
+        return std::unexpected(current_token.error());
+    }
+
+    switch (current_token->type()) {
+        case TokenType::KeywordOrIdentifier: {
+            static_assert(
+              std::to_underlying(TokenType::Max) == 10,
+              "[INTERNAL ERROR] Parser::next() requires to handle all enum "
+              "variants"
+            );
+            if (current_token->keyword() == Keyword::Fn) {
+                return this->parse_function();
+            } else if (current_token->keyword() == Keyword::End) {
+                this->error(
+                  "end without a matching begin", current_token->span()
+                );
+                this->advance();
+            } else {
+                // FIXME: Once we handle all the keyword/identifiers make this
+                //        an unknown keyword/identifier error
+                fmt::println(
+                  "[INTERNAL ERROR] unimplemented {} keyword/identifier "
+                  "compilation! (skipping)",
+                  current_token->lexeme(*this->m_compiler)
+                );
+                this->advance();
+            }
+            break;
+        }
+        default: {
+            // FIXME: Once we handle all the tokens make this an unknown token
+            //        error
+            fmt::println(
+              "[INTERNAL ERROR] unimplemented {} token compilation! (skipping)",
+              current_token->lexeme(*this->m_compiler)
+            );
+            this->advance();
+        }
+    }
+
+    return {};
+}
+
+auto Parser::parse_function() -> std::expected<void, ParseError> {
+    // Skip "fn" token
+    const auto fn_keyword = this->peek().value();
+    this->advance();
+
+    // Get function identifier
+    const auto function_name = this->peek();
+    if (!function_name.has_value()) {
+        this->error(
+          "expected identifier after 'fn' keyword, function name is missing",
+          fn_keyword.span()
+        );
+        return std::unexpected(ParseError::MissingFunctionName);
+    }
+    const auto name = function_name->lexeme(*this->m_compiler);
+    if (!this->m_function_names.insert(name).second) {
+        this->error(
+          fmt::format("function `{}` defined twice", name),
+          function_name->span()
+        );
+        return std::unexpected(ParseError::DuplicateFunction);
+    }
+    this->advance();
+
+    // Check if function has parameter list
+    const auto has_params = [&]() -> bool {
+        const auto& next_token = this->peek();
+        if (!next_token.has_value()) {
+            this->error(
+              "expected parameter list or return type after function name",
+              function_name->span()
+            );
+            return false;
+        }
+
+        return next_token->type() == TokenType::MinusMinus;
+    }();
+
+    // Parse parameter list
+    if (has_params) {
+        FMT_ASSERT(
+          false,
+          "[INTERNAL ERROR] Unimplemented function parameter list parsin\n"
+        );
+    }
+
+    // Check return type
+    const auto arrow = this->peek();
+    if (!arrow.has_value() || arrow->type() != TokenType::Arrow) {
+        // FIXME: This span is not always correct: it should be either the
+        //        function name's span or the last function parameter's span
+        this->error(
+          "expected return type after function name or parameter list",
+          function_name->span()
+        );
+        return std::unexpected(
+          ParseError::MissingFunctionParametersOrReturnType
+        );
+    }
+    this->advance();
+
+    const auto return_type = this->peek();
+    // FIXME: Check if return type is a valid return type
+    if (!return_type.has_value()) {
+        this->error(
+          "expected return type after function name or parameter list",
+          arrow->span()
+        );
+        return std::unexpected(
+          ParseError::MissingFunctionParametersOrReturnType
+        );
+    }
+    this->advance();
+
+    const auto begin_token = this->peek();
+    if (!begin_token.has_value() || begin_token->keyword() != Keyword::Begin) {
+        this->error(
+          "expected begin after function return type", return_type->span()
+        );
+        return std::unexpected(ParseError::NoBeginToken);
+    }
+    this->open_block(begin_token.value());
+
+    const auto body = this->parse_function_body();
+    if (!body.has_value()) {
+        if (body.error() == ParseError::NoEndToken) {
+            this->error(
+              "expected end token after function body", begin_token->span()
+            );
+        }
+        return std::unexpected(body.error());
+    }
+
+    this->m_program.functions.push_back(ast::Function{
+      .name        = function_name.value(),
+      .return_type = return_type.value(),
+      .body        = body.value(),
+    });
+
+    return {};
+}
+
+auto Parser::parse_function_body()
+  -> std::expected<std::span<const ast::Statement>, ParseError> {
+    // The body is parsed as the tokens come in, up to the end matching the
+    // function's begin, which is already on the block stack
+    const auto depth = this->m_blocks.size();
+
+    while (this->peek().has_value()) {
+        const auto& token = this->peek();
+
+        if (token->keyword() == Keyword::End) {
+            const auto begin = this->m_blocks.back().begin;
+            const auto body  = this->close_block();
+            if (this->m_blocks.size() < depth) { return body; }
+
+            this->m_statements.push_back(ast::Statement{
+              .kind           = ast::StatementKind::Block,
+              .token          = begin,
+              .children       = body.data(),
+              .children_count = static_cast<std::uint32_t>(body.size()),
+            });
+            continue;
+        }
+
+        switch (token->type()) {
+            case TokenType::DoubleQuotedString: {
+                this->m_statements.push_back(ast::Statement{
+                  .kind  = ast::StatementKind::StringLiteral,
+                  .token = token.value(),
+                });
+                this->advance();
+                break;
+            }
+            case TokenType::Number: {
+                this->m_statements.push_back(ast::Statement{
+                  .kind  = ast::StatementKind::NumberLiteral,
+                  .token = token.value(),
+                });
+                this->advance();
+                break;
+            }
+            case TokenType::Plus:
+            case TokenType::Minus:
+            case TokenType::Asterisk: {
+                this->m_statements.push_back(ast::Statement{
+                  .kind  = ast::StatementKind::Arithmetic,
+                  .token = token.value(),
+                });
+                this->advance();
+                break;
+            }
+            case TokenType::KeywordOrIdentifier: {
+                if (token->keyword() == Keyword::Begin) {
+                    this->open_block(token.value());
+                } else if (token->is_keyword()) {
+                    this->m_statements.push_back(ast::Statement{
+                      .kind  = ast::StatementKind::Keyword,
+                      .token = token.value(),
+                    });
+                    this->advance();
+                } else {
+                    const auto result =
+                      this->parse_function_call(token.value());
+                    if (!result.has_value()) {
+                        return std::unexpected(result.error());
+                    }
+                }
+                break;
+            }
+            default: {
+                // Reported past the token, in case the lexer fails on the
+                // next one
+                const auto unexpected = token.value();
+                this->advance();
+                this->error(
+                  fmt::format(
+                    "{} is not allowed in this context",
+                    unexpected.type_to_string()
+                  ),
+                  unexpected.span()
+                );
+            }
+        }
+    }
+
+    // Blocks nested in the body are reported here, the function's own begin
+    // by the caller
+    while (this->m_blocks.size() > depth) {
+        this->error(
+          "expected end token after block", this->m_blocks.back().begin.span()
+        );
+        this->m_blocks.pop_back();
+    }
+    this->m_blocks.pop_back();
+
+    const auto error = this->peek().error();
+    return std::unexpected(
+      error == ParseError::Eof ? ParseError::NoEndToken : error
+    );
+}
+
+void Parser::open_block(const Token& begin_token) {
+    this->m_blocks.push_back(
+      Block{ .begin = begin_token, .first = this->m_statements.size() }
+    );
+    this->advance();
+}
+
+auto Parser::close_block() -> std::span<const ast::Statement> {
+    const auto first = this->m_blocks.back().first;
+    this->m_blocks.pop_back();
+    this->advance();
+
+    const auto statements =
+      std::span<const ast::Statement>(this->m_statements).subspan(first);
+    const auto body = this->m_compiler->arena().copy(statements);
+    this->m_statements.erase(
+      this->m_statements.begin() + static_cast<std::ptrdiff_t>(first),
+      this->m_statements.end()
+    );
+    return body;
+}
+
+auto Parser::parse_function_call(const Token& token)
+  -> std::expected<void, ParseError> {
+    if (token.builtin() == Builtin::None) {
+        this->error(
+          fmt::format(
+            "undeclared function {}", token.lexeme(*this->m_compiler)
+          ),
+          token.span()
+        );
+        return std::unexpected(ParseError::UndeclaredFunction);
+    }
+
+    this->m_statements.push_back(ast::Statement{
+      .kind  = ast::StatementKind::Call,
+      .token = token,
+    });
+    this->advance();
+    return {};
+}
@@ -0,0 +1,134 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#define FMT_HEADER_ONLY
+
+#include "Ast.hpp"
+#include "Compiler.hpp"
+#include "Lexer.hpp"
+#include <expected>
+#include <fmt/format.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+enum class ParseError : std::uint8_t {
+    Eof = 0,
+    MissingFunctionName,
+    MissingFunctionParametersOrReturnType,
+    NoBeginToken,
+    NoEndToken,
+    UndeclaredFunction,
+    DuplicateFunction,
+    LexFailure,
+    Max,
+};
+
+/// Builds the ast::Program out of the token stream, reporting syntax errors
+/// to the Compiler. Statements go to the compilation's arena.
+class Parser {
+  public:
+    [[nodiscard]] static auto
+      parse(const std::shared_ptr<Compiler>& compiler, TokenStream tokens)
+        -> std::expected<ast::Program, ParseError>;
+
+  private:
+    Parser(const std::shared_ptr<Compiler>& compiler, TokenStream tokens);
+
+    void error(const std::string& message, const Span& span);
+
+    /// The current token, read once per advance() instead of being copied
+    /// out of the stream at every look
+    [[nodiscard]] auto peek() const -> const std::expected<Token, ParseError>&;
+    void               advance();
+    [[nodiscard]] auto next() -> std::expected<void, ParseError>;
+
+    [[nodiscard]] auto parse_function() -> std::expected<void, ParseError>;
+    [[nodiscard]] auto parse_function_body()
+      -> std::expected<std::span<const ast::Statement>, ParseError>;
+    void               open_block(const Token& begin_token);
+    /// Pops the innermost block, returns its statements once in the arena
+    [[nodiscard]] auto close_block() -> std::span<const ast::Statement>;
+    [[nodiscard]] auto parse_function_call(const Token& token)
+      -> std::expected<void, ParseError>;
+
+    /// begin whose end has not been seen yet
+    struct Block {
+        Token       begin;
+        // Where its statements start in m_statements
+        std::size_t first;
+    };
+
+    [[nodiscard]] static auto read(TokenStream& tokens)
+      -> std::expected<Token, ParseError>;
+
+    std::shared_ptr<Compiler>            m_compiler;
+    TokenStream                          m_tokens;
+    std::expected<Token, ParseError>     m_current;
+    ast::Program                         m_program;
+    // Names of the functions parsed so far, a name is defined once
+    std::unordered_set<std::string_view> m_function_names;
+    // Blocks still waiting for their end, innermost last. Blocks are matched
+    // as the tokens stream in, so finding the end of a body never needs to
+    // look further than the current token.
+    std::vector<Block>                   m_blocks;
+    // Statements of the open blocks, moved to the arena once a block closes
+    std::vector<ast::Statement>          m_statements;
+};
+
+// {fmt} - Custom Formatters
+template<>
+struct fmt::formatter<ParseError> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const ParseError& error, FormatContext& ctx) {
+        static_assert(
+          std::to_underlying(ParseError::Max) == 8,
+          "[INTERNAL ERROR] fmt::formatter<ParseError> requires to handle all "
+          "enum variants"
+        );
+
+        const auto enum_to_str = [](const ParseError& error) {
+            switch (error) {
+                case ParseError::Eof: {
+                    return "ParseError::Eof";
+                }
+                case ParseError::MissingFunctionName: {
+                    return "ParseError::MissingFunctionName";
+                }
+                case ParseError::MissingFunctionParametersOrReturnType: {
+                    return "ParseError::MissingFunctionParametersOrReturnType";
+                }
+                case ParseError::NoBeginToken: {
+                    return "ParseError::NoBeginToken";
+                }
+                case ParseError::NoEndToken: {
+                    return "ParseError::NoEndToken";
+                }
+                case ParseError::UndeclaredFunction: {
+                    return "ParseError::UndeclaredFunction";
+                }
+                case ParseError::DuplicateFunction: {
+                    return "ParseError::DuplicateFunction";
+                }
+                case ParseError::LexFailure: {
+                    return "ParseError::LexFailure";
+                }
+                default: {
+                    return "Unknown Parse Error";
+                }
+            }
+        };
+
+        return fmt::format_to(ctx.out(), "{}", enum_to_str(error));
+    }
+};
+
+#endif // PARSER_HPP
@@ -0,0 +1,266 @@
+#include "Passes.hpp"
+
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+auto PassManager::create(const OptimizationLevel level) -> PassManager {
+    static_assert(
+      std::to_underlying(OptimizationLevel::Max) == 3,
+      "[INTERNAL ERROR] PassManager::create() requires to handle all "
+      "optimization levels"
+    );
+
+    PassManager manager;
+    manager.add(
+      { "dead-function-elimination", passes::dead_function_elimination }
+    );
+    if (level >= OptimizationLevel::O2) {
+        manager.add({ "constant-folding", passes::constant_folding });
+        manager.add({ "constant-print", passes::constant_print });
+    }
+    if (level >= OptimizationLevel::O1) {
+        manager.add(
+          { "dead-code-elimination", passes::dead_code_elimination }
+        );
+    }
+    return manager;
+}
+
+void PassManager::add(const Pass& pass) { this->m_passes.push_back(pass); }
+
+void PassManager::run(ir::Module& module, const bool print_ir) const {
+    const auto check = [&](const std::string_view stage) {
+        if (print_ir) {
+            fmt::println("; {}", stage);
+            for (const auto& function : module.functions) {
+                fmt::println("{}\n", function);
+            }
+        }
+
+        for (const auto& function : module.functions) {
+            const auto result = ir::verify(function);
+            if (!result.has_value()) {
+                fmt::print(
+                  stderr,
+                  "[INTERNAL ERROR] invalid IR {} in {}: {}\n",
+                  stage,
+                  function.name,
+                  result.error()
+                );
+                std::abort();
+            }
+        }
+    };
+
+    check("after lowering");
+    for (const auto& pass : this->m_passes) {
+        pass.run(module);
+        check(fmt::format("after {}", pass.name));
+    }
+}
+
+namespace passes {
+
+void dead_function_elimination(ir::Module& module) {
+    // The parser rejects a function defined twice, so names are unique
+    std::unordered_map<std::string_view, std::size_t> indices;
+    for (std::size_t idx = 0; idx < module.functions.size(); ++idx) {
+        const auto inserted =
+          indices.try_emplace(module.functions[idx].name, idx).second;
+        FMT_ASSERT(
+          inserted,
+          "[INTERNAL ERROR] dead_function_elimination(): function defined "
+          "twice\n"
+        );
+    }
+
+    std::vector<bool>        reachable(module.functions.size(), false);
+    std::vector<std::size_t> pending;
+    const auto               reach = [&](const std::string_view name) {
+        const auto function = indices.find(name);
+        if (function == indices.end() || reachable[function->second]) {
+            return;
+        }
+        reachable[function->second] = true;
+        pending.push_back(function->second);
+    };
+
+    // Walks the call graph from main. Note that no function can call
+    // another one yet, every Call applies a builtin: main is the only
+    // function reached for now.
+    reach("main");
+    while (!pending.empty()) {
+        const auto& function = module.functions[pending.back()];
+        pending.pop_back();
+        for (const auto& instruction : function.body) {
+            if (instruction.opcode == ir::Opcode::Call
+                && instruction.builtin == Builtin::None) {
+                reach(instruction.callee);
+            }
+        }
+    }
+
+    std::vector<ir::Function> reached;
+    for (std::size_t idx = 0; idx < module.functions.size(); ++idx) {
+        if (reachable[idx]) {
+            reached.push_back(std::move(module.functions[idx]));
+        }
+    }
+    module.functions = std::move(reached);
+}
+
+void dead_code_elimination(ir::Module& module) {
+    for (auto& function : module.functions) {
+        auto&             body = function.body;
+        std::vector<bool> used(function.value_count, false);
+        std::vector<bool> kept(body.size(), false);
+
+        // Uses always come after the definition, so walking backwards sees
+        // every use of a value before the value itself
+        for (auto idx = body.size(); idx-- > 0;) {
+            const auto& instruction = body[idx];
+            if (!instruction.has_side_effects()
+                && (instruction.type == ir::Type::Void
+                    || !used[instruction.result])) {
+                continue;
+            }
+
+            kept[idx] = true;
+            for (std::size_t operand = 0; operand < instruction.operand_count;
+                 ++operand) {
+                used[instruction.operands[operand]] = true;
+            }
+        }
+
+        std::size_t count = 0;
+        for (std::size_t idx = 0; idx < body.size(); ++idx) {
+            if (kept[idx]) { body[count++] = body[idx]; }
+        }
+        body.resize(count);
+    }
+}
+
+void constant_folding(ir::Module& module) {
+    for (auto& function : module.functions) {
+        // Where each constant is defined in `body`
+        std::vector<std::optional<std::size_t>> constants(
+          function.value_count
+        );
+        std::vector<ir::Instruction> body;
+        std::vector<bool>            removed;
+        body.reserve(function.body.size());
+        removed.reserve(function.body.size());
+
+        for (const auto& instruction : function.body) {
+            if (!ir::is_arithmetic(instruction.opcode)
+                || !constants[instruction.operands[0]].has_value()
+                || !constants[instruction.operands[1]].has_value()) {
+                if (instruction.opcode == ir::Opcode::Const) {
+                    constants[instruction.result] = body.size();
+                }
+                body.push_back(instruction);
+                removed.push_back(false);
+                continue;
+            }
+
+            // Both operands are used up, see constant_print()
+            const auto lhs = constants[instruction.operands[0]].value();
+            const auto rhs = constants[instruction.operands[1]].value();
+            removed[lhs]   = true;
+            removed[rhs]   = true;
+
+            constants[instruction.result] = body.size();
+            body.push_back(ir::Instruction{
+              .opcode    = ir::Opcode::Const,
+              .type      = ir::Type::I64,
+              .result    = instruction.result,
+              .immediate = ir::fold(
+                instruction.opcode, body[lhs].immediate, body[rhs].immediate
+              ),
+            });
+            removed.push_back(false);
+        }
+
+        std::size_t count = 0;
+        for (std::size_t idx = 0; idx < body.size(); ++idx) {
+            if (!removed[idx]) { body[count++] = body[idx]; }
+        }
+        body.resize(count);
+        function.body = std::move(body);
+    }
+}
+
+void constant_print(ir::Module& module) {
+    for (auto& function : module.functions) {
+        // Where each constant is defined in `body`
+        std::vector<std::optional<std::size_t>> constants(
+          function.value_count
+        );
+        std::vector<ir::Instruction> body;
+        std::vector<bool>            removed;
+        body.reserve(function.body.size());
+        removed.reserve(function.body.size());
+
+        for (const auto& instruction : function.body) {
+            if (instruction.opcode == ir::Opcode::Const) {
+                constants[instruction.result] = body.size();
+            }
+
+            if (instruction.opcode != ir::Opcode::Call
+                || instruction.builtin != Builtin::Print
+                || !constants[instruction.operands[0]].has_value()) {
+                body.push_back(instruction);
+                removed.push_back(false);
+                continue;
+            }
+
+            // Values have a single use, the constant goes away with the
+            // print. Leaving it would break the stack order.
+            const auto definition = constants[instruction.operands[0]].value();
+            removed[definition]   = true;
+
+            // print writes the value as signed, followed by a newline. The
+            // same values tend to be printed over and over, the pool only
+            // keeps their digits once.
+            const auto value  = body[definition].immediate;
+            const auto string =
+              module.strings.intern(fmt::format("{}\n", value));
+
+            const auto size    = function.value_count++;
+            const auto address = function.value_count++;
+            body.push_back(ir::Instruction{
+              .opcode    = ir::Opcode::Const,
+              .type      = ir::Type::I64,
+              .result    = size,
+              .immediate = static_cast<std::int64_t>(
+                module.strings.get(string).size()
+              ),
+            });
+            body.push_back(ir::Instruction{
+              .opcode    = ir::Opcode::String,
+              .type      = ir::Type::Ptr,
+              .result    = address,
+              .immediate = string,
+            });
+            body.push_back(ir::Instruction{
+              .opcode        = ir::Opcode::Call,
+              .builtin       = Builtin::Puts,
+              .operand_count = 2,
+              .operands      = { size, address },
+            });
+            removed.resize(body.size(), false);
+        }
+
+        std::size_t count = 0;
+        for (std::size_t idx = 0; idx < body.size(); ++idx) {
+            if (!removed[idx]) { body[count++] = body[idx]; }
+        }
+        body.resize(count);
+        function.body = std::move(body);
+    }
+}
+
+} // namespace passes
@@ -0,0 +1,63 @@
+#ifndef PASSES_HPP
+#define PASSES_HPP
+
+#include "Ir.hpp"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+enum class OptimizationLevel : std::uint8_t {
+    // Code generated as written, for the functions main can reach
+    O0 = 0,
+    // Values never used are not computed
+    O1,
+    // Work known at compile time is done at compile time
+    O2,
+    Max
+};
+
+/// Runs a pipeline of IR passes, selected by the optimization level
+class PassManager {
+  public:
+    struct Pass {
+        std::string_view name;
+        void (*run)(ir::Module& module);
+    };
+
+    [[nodiscard]] static auto create(const OptimizationLevel level)
+      -> PassManager;
+
+    void add(const Pass& pass);
+
+    /// Runs every pass in order, verifying the IR after each of them. With
+    /// `print_ir`, the module is dumped to stdout once lowered and after
+    /// every pass.
+    void run(ir::Module& module, const bool print_ir) const;
+
+  private:
+    PassManager() = default;
+
+    std::vector<Pass> m_passes;
+};
+
+namespace passes {
+
+/// Removes the functions main cannot reach through calls: they would only
+/// take room in the executable, and a section of their own in the object
+/// file
+void dead_function_elimination(ir::Module& module);
+
+/// Removes the instructions without side effects whose result is unused,
+/// e.g. values left on the stack when a function returns
+void dead_code_elimination(ir::Module& module);
+
+/// Replaces arithmetic on constants with its result, e.g. `2 3 *` with `6`
+void constant_folding(ir::Module& module);
+
+/// Turns `print` of a constant into `puts` of its digits, created at
+/// compile time
+void constant_print(ir::Module& module);
+
+} // namespace passes
+
+#endif // PASSES_HPP
@@ -0,0 +1,481 @@
+#include "Peephole.hpp"
+
+#include <initializer_list>
+#include <optional>
+
+namespace x86 {
+
+namespace {
+
+/// One bit per register number, sub-registers alias their 64-bit register
+using RegisterSet = std::uint32_t;
+
+constexpr RegisterSet every_register = 0xFFFFU;
+
+[[nodiscard]] constexpr auto bit(const Register reg) -> RegisterSet {
+    return RegisterSet{ 1 } << number(reg);
+}
+
+[[nodiscard]] constexpr auto
+  bits(const std::initializer_list<Register> registers) -> RegisterSet {
+    RegisterSet set = 0;
+    for (const auto reg : registers) { set |= bit(reg); }
+    return set;
+}
+
+/// Registers a call to `callee` may overwrite, every one of them unless it
+/// is part of the runtime. puts keeps r8 and r9, so printing the same string
+/// over and over only loads it once: src/Runtime.s and the JIT trampolines
+/// have to keep it that way.
+[[nodiscard]] auto clobbered_by(const Operand& callee) -> RegisterSet {
+    using Register::Rax, Register::Rcx, Register::Rdx, Register::Rsi;
+    using Register::Rdi, Register::R8, Register::R9, Register::R10;
+    using Register::R11;
+
+    // Everything syscall and the System V ABI leave to the callee, but the
+    // arguments
+    static constexpr auto puts = bits({ Rax, Rcx, Rdx, Rsi, Rdi, R10, R11 });
+
+    const auto* label = std::get_if<Label>(&callee);
+    if (label == nullptr) { return every_register; }
+    if (label->name == "puts") { return puts; }
+    if (label->name == "print") { return puts | bits({ R8, R9 }); }
+    return every_register;
+}
+
+struct Effects {
+    RegisterSet reads        = 0;
+    RegisterSet writes       = 0;
+    bool        reads_flags  = false;
+    bool        writes_flags = false;
+    // Writes memory or transfers control, kept even if nothing it writes is
+    // read afterwards
+    bool        side_effects = false;
+};
+
+/// Registers used to compute the address of `operand`, if it is in memory
+[[nodiscard]] auto address_reads(const Operand& operand) -> RegisterSet {
+    const auto* memory = std::get_if<Memory>(&operand);
+    if (memory == nullptr) { return 0; }
+
+    RegisterSet set = 0;
+    if (memory->base.has_value()) { set |= bit(memory->base.value()); }
+    if (memory->index.has_value()) { set |= bit(memory->index.value()); }
+    return set;
+}
+
+/// Registers read to evaluate `operand`
+[[nodiscard]] auto value_reads(const Operand& operand) -> RegisterSet {
+    if (const auto* reg = std::get_if<Register>(&operand)) { return bit(*reg); }
+    return address_reads(operand);
+}
+
+/// Records `operand` being written. Writing a 32-bit register clears the
+/// upper half, but writing an 8-bit one keeps the rest: the register is
+/// read too.
+void write(Effects& effects, const Operand& operand) {
+    if (const auto* reg = std::get_if<Register>(&operand)) {
+        effects.writes |= bit(*reg);
+        if (width(*reg) == Width::Byte) { effects.reads |= bit(*reg); }
+        return;
+    }
+
+    effects.reads |= address_reads(operand);
+    if (std::holds_alternative<Memory>(operand)) {
+        effects.side_effects = true;
+    }
+}
+
+/// xor reg, reg: the result does not depend on the register
+[[nodiscard]] auto is_zeroing(const Instruction& instruction) -> bool {
+    const auto* dst = std::get_if<Register>(&instruction.destination);
+    const auto* src = std::get_if<Register>(&instruction.source);
+    return instruction.mnemonic == Mnemonic::Xor && dst != nullptr
+           && src != nullptr && *dst == *src && width(*dst) != Width::Byte;
+}
+
+[[nodiscard]] auto effects(const Instruction& instruction) -> Effects {
+    static_assert(
+      std::to_underlying(Mnemonic::Max) == 35,
+      "[INTERNAL ERROR] x86::effects() requires to handle all mnemonics"
+    );
+
+    using enum Mnemonic;
+    using Register::Rax, Register::Rcx, Register::Rdx, Register::Rsi;
+    using Register::Rdi, Register::Rsp, Register::R8, Register::R9;
+    using Register::R10, Register::R11;
+
+    const auto& dst = instruction.destination;
+    const auto& src = instruction.source;
+
+    Effects effects;
+    switch (instruction.mnemonic) {
+        case Mov: {
+            write(effects, dst);
+            effects.reads |= value_reads(src);
+            break;
+        }
+        case Lea: {
+            write(effects, dst);
+            effects.reads |= address_reads(src);
+            break;
+        }
+        case Push: {
+            effects.reads        |= value_reads(dst) | bit(Rsp);
+            effects.writes       |= bit(Rsp);
+            effects.side_effects  = true;
+            break;
+        }
+        case Pop: {
+            write(effects, dst);
+            effects.reads        |= bit(Rsp);
+            effects.writes       |= bit(Rsp);
+            effects.side_effects  = true;
+            break;
+        }
+        case Add:
+        case Sub:
+        case Imul:
+        case Neg:
+        case And:
+        case Or:
+        case Xor:
+        case Shl:
+        case Shr:
+        case Sar: {
+            write(effects, dst);
+            if (!is_zeroing(instruction)) {
+                effects.reads |= value_reads(dst) | value_reads(src);
+            }
+            effects.writes_flags = true;
+            break;
+        }
+        case Bsr: {
+            // Only defined for a non-zero source, the destination is then
+            // not read
+            write(effects, dst);
+            effects.reads        |= value_reads(src);
+            effects.writes_flags  = true;
+            break;
+        }
+        case Cmp:
+        case Test: {
+            effects.reads        |= value_reads(dst) | value_reads(src);
+            effects.writes_flags  = true;
+            break;
+        }
+        case Mul:
+        case Div:
+        case Idiv: {
+            effects.reads |= value_reads(dst) | bit(Rax);
+            if (instruction.mnemonic != Mul) { effects.reads |= bit(Rdx); }
+            effects.writes       |= bits({ Rax, Rdx });
+            effects.writes_flags  = true;
+            break;
+        }
+        case Cqo: {
+            effects.reads  |= bit(Rax);
+            effects.writes |= bit(Rdx);
+            break;
+        }
+        case Call: {
+            effects.reads        = every_register;
+            effects.writes       = clobbered_by(dst);
+            effects.writes_flags = true;
+            effects.side_effects = true;
+            break;
+        }
+        case Ret: {
+            // Like calls, returns do not keep the flags for the caller
+            effects.reads        = every_register;
+            effects.writes_flags = true;
+            effects.side_effects = true;
+            break;
+        }
+        case Syscall: {
+            // The kernel restores the flags
+            effects.reads        = bits({ Rax, Rdi, Rsi, Rdx, R10, R8, R9 });
+            effects.writes       = bits({ Rax, Rcx, R11 });
+            effects.side_effects = true;
+            break;
+        }
+        default: {
+            // Jumps: whatever the target needs is unknown here
+            effects.reads        = every_register;
+            effects.reads_flags  = true;
+            effects.side_effects = true;
+            break;
+        }
+    }
+    return effects;
+}
+
+[[nodiscard]] auto same(const Operand& lhs, const Operand& rhs) -> bool {
+    if (lhs.index() != rhs.index()) { return false; }
+
+    if (const auto* reg = std::get_if<Register>(&lhs)) {
+        return *reg == std::get<Register>(rhs);
+    }
+    if (const auto* immediate = std::get_if<Immediate>(&lhs)) {
+        return immediate->value == std::get<Immediate>(rhs).value;
+    }
+    if (const auto* memory = std::get_if<Memory>(&lhs)) {
+        const auto& other = std::get<Memory>(rhs);
+        return memory->width == other.width && memory->base == other.base
+               && memory->index == other.index && memory->scale == other.scale
+               && memory->displacement == other.displacement
+               && memory->symbol == other.symbol;
+    }
+    return false;
+}
+
+/// The register `instruction` loads with something known at compile time,
+/// and that value: an immediate, a copy of another register, or the address
+/// of a symbol
+[[nodiscard]] auto loaded_value(const Instruction& instruction)
+  -> std::optional<std::pair<Register, Operand>> {
+    const auto* dst = std::get_if<Register>(&instruction.destination);
+    if (dst == nullptr || width(*dst) == Width::Byte) { return std::nullopt; }
+    const auto reg = resize(*dst, Width::Qword);
+
+    if (is_zeroing(instruction)) { return { { reg, Immediate{ 0 } } }; }
+
+    const auto& src = instruction.source;
+    if (instruction.mnemonic == Mnemonic::Mov) {
+        if (const auto* immediate = std::get_if<Immediate>(&src)) {
+            // Zero extended from 32 bits
+            const auto value =
+              width(*dst) == Width::Qword
+                ? immediate->value
+                : static_cast<std::int64_t>(
+                    static_cast<std::uint32_t>(immediate->value)
+                  );
+            return { { reg, Immediate{ value } } };
+        }
+        const auto* src_reg = std::get_if<Register>(&src);
+        if (src_reg != nullptr && width(*dst) == Width::Qword
+            && width(*src_reg) == Width::Qword) {
+            return { { reg, *src_reg } };
+        }
+    }
+
+    if (instruction.mnemonic == Mnemonic::Lea) {
+        const auto* memory = std::get_if<Memory>(&src);
+        if (memory != nullptr && !memory->symbol.empty()
+            && address_reads(src) == 0) {
+            return { { reg, src } };
+        }
+    }
+
+    return std::nullopt;
+}
+
+void compact(Listing& listing, const std::vector<bool>& removed) {
+    std::size_t count = 0;
+    for (std::size_t idx = 0; idx < listing.size(); ++idx) {
+        if (removed[idx]) { continue; }
+        if (count != idx) { listing[count] = std::move(listing[idx]); }
+        ++count;
+    }
+    listing.erase(
+      listing.begin() + static_cast<std::ptrdiff_t>(count), listing.end()
+    );
+}
+
+void count(PeepholeStats& stats, const PeepholeRule rule) {
+    ++stats[std::to_underlying(rule)];
+}
+
+/// push x; pop reg -> mov reg, x
+void merge_push_pop(Listing& listing, PeepholeStats& stats) {
+    std::vector<bool> removed(listing.size(), false);
+
+    for (std::size_t idx = 0; idx + 1 < listing.size(); ++idx) {
+        auto*       push = std::get_if<Instruction>(&listing[idx]);
+        const auto* pop  = std::get_if<Instruction>(&listing[idx + 1]);
+        if (push == nullptr || pop == nullptr
+            || push->mnemonic != Mnemonic::Push
+            || pop->mnemonic != Mnemonic::Pop
+            || std::holds_alternative<Label>(push->destination)) {
+            continue;
+        }
+
+        const auto* reg = std::get_if<Register>(&pop->destination);
+        if (reg == nullptr || *reg == Register::Rsp) { continue; }
+
+        removed[idx + 1] = true;
+        count(stats, PeepholeRule::PushPop);
+        if (same(push->destination, *reg)) {
+            removed[idx] = true;
+            count(stats, PeepholeRule::PushPop);
+        } else {
+            *push = { Mnemonic::Mov, *reg, push->destination };
+        }
+        ++idx;
+    }
+
+    compact(listing, removed);
+}
+
+/// Follows what every register holds through the listing, and removes the
+/// moves that would not change it
+void remove_redundant_moves(Listing& listing, PeepholeStats& stats) {
+    std::array<std::optional<Operand>, 16> known;
+    std::vector<bool>                      removed(listing.size(), false);
+
+    for (std::size_t idx = 0; idx < listing.size(); ++idx) {
+        const auto* instruction = std::get_if<Instruction>(&listing[idx]);
+
+        // Reached from elsewhere, nothing is known anymore
+        if (instruction == nullptr) {
+            known.fill(std::nullopt);
+            continue;
+        }
+
+        auto loaded = loaded_value(*instruction);
+        if (loaded.has_value()) {
+            auto& [reg, value] = loaded.value();
+
+            // A copy of a known value is that value
+            if (const auto* src = std::get_if<Register>(&value)) {
+                const auto& source = known[number(*src)];
+                if (source.has_value()
+                    && !std::holds_alternative<Register>(source.value())) {
+                    value = source.value();
+                }
+            }
+
+            const auto& current = known[number(reg)];
+            const auto* src     = std::get_if<Register>(&value);
+            const auto  redundant =
+              (current.has_value() && same(current.value(), value))
+              || (src != nullptr
+                  && (*src == reg
+                      || (known[number(*src)].has_value()
+                          && same(known[number(*src)].value(), reg))));
+
+            // xor also writes the flags, it has to stay
+            if (redundant && instruction->mnemonic != Mnemonic::Xor) {
+                removed[idx] = true;
+                count(stats, PeepholeRule::RedundantMov);
+                continue;
+            }
+        }
+
+        const auto written = effects(*instruction).writes;
+        for (std::size_t reg = 0; reg < known.size(); ++reg) {
+            auto& contents = known[reg];
+            if ((written & (RegisterSet{ 1 } << reg)) != 0) {
+                contents.reset();
+                continue;
+            }
+            const auto* copy = contents.has_value()
+                                 ? std::get_if<Register>(&contents.value())
+                                 : nullptr;
+            if (copy != nullptr && (written & bit(*copy)) != 0) {
+                contents.reset();
+            }
+        }
+
+        if (loaded.has_value()) {
+            known[number(loaded->first)] = std::move(loaded->second);
+        }
+    }
+
+    compact(listing, removed);
+}
+
+/// Removes jumps to the label following them
+void remove_jumps_to_next(Listing& listing, PeepholeStats& stats) {
+    std::vector<bool> removed(listing.size(), false);
+
+    for (std::size_t idx = 0; idx < listing.size(); ++idx) {
+        // Jumps come last in Mnemonic
+        const auto* jump = std::get_if<Instruction>(&listing[idx]);
+        if (jump == nullptr || jump->mnemonic < Mnemonic::Jmp) { continue; }
+
+        const auto* target = std::get_if<Label>(&jump->destination);
+        if (target == nullptr) { continue; }
+
+        for (auto next = idx + 1; next < listing.size(); ++next) {
+            const auto* label = std::get_if<LabelDefinition>(&listing[next]);
+            if (label == nullptr) { break; }
+            if (label->name == target->name) {
+                removed[idx] = true;
+                count(stats, PeepholeRule::JumpToNext);
+                break;
+            }
+            // Starts a new scope for NASM local labels
+            if (!label->name.starts_with('.')) { break; }
+        }
+    }
+
+    compact(listing, removed);
+}
+
+/// Walks the listing backwards tracking which registers and whether the
+/// flags are still to be read: removes the instructions only writing dead
+/// ones, and turns `mov reg, 0` into the shorter xor where the flags are
+/// dead
+void remove_dead_stores(Listing& listing, PeepholeStats& stats) {
+    std::vector<bool> removed(listing.size(), false);
+    auto              live       = every_register;
+    auto              flags_live = true;
+
+    // Labels need no special care: every jump to them reads everything
+    for (auto idx = listing.size(); idx-- > 0;) {
+        auto* instruction = std::get_if<Instruction>(&listing[idx]);
+        if (instruction == nullptr) { continue; }
+
+        auto effects = x86::effects(*instruction);
+        if (!effects.side_effects && (effects.writes & live) == 0
+            && (!effects.writes_flags || !flags_live)) {
+            removed[idx] = true;
+            count(stats, PeepholeRule::DeadStore);
+            continue;
+        }
+
+        const auto* dst = std::get_if<Register>(&instruction->destination);
+        const auto* src = std::get_if<Immediate>(&instruction->source);
+        if (!flags_live && instruction->mnemonic == Mnemonic::Mov
+            && dst != nullptr && width(*dst) != Width::Byte && src != nullptr
+            && src->value == 0) {
+            const auto reg = resize(*dst, Width::Dword);
+            *instruction   = { Mnemonic::Xor, reg, reg };
+            effects        = x86::effects(*instruction);
+            count(stats, PeepholeRule::ZeroIdiom);
+        }
+
+        live       = (live & ~effects.writes) | effects.reads;
+        flags_live = (flags_live && !effects.writes_flags)
+                     || effects.reads_flags;
+    }
+
+    compact(listing, removed);
+}
+
+} // namespace
+
+void peephole(Listing& listing, PeepholeStats& stats) {
+    static_assert(
+      std::to_underlying(PeepholeRule::Max) == 5,
+      "[INTERNAL ERROR] x86::peephole() requires to handle all rules"
+    );
+
+    merge_push_pop(listing, stats);
+    remove_redundant_moves(listing, stats);
+    remove_jumps_to_next(listing, stats);
+    // Last, the moves above may leave more dead stores
+    remove_dead_stores(listing, stats);
+}
+
+auto to_string(const PeepholeRule rule) -> std::string_view {
+    static constexpr auto count = std::to_underlying(PeepholeRule::Max);
+    static constexpr std::array<std::string_view, count> names = {
+        "push-pop", "redundant-mov", "dead-store", "zero-idiom",
+        "jump-to-next",
+    };
+    return names[std::to_underlying(rule)];
+}
+
+} // namespace x86
@@ -0,0 +1,58 @@
+#ifndef PEEPHOLE_HPP
+#define PEEPHOLE_HPP
+
+#include "X86.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace x86 {
+
+struct LabelDefinition {
+    std::string name;
+    bool        global = false;
+};
+
+/// Machine code in emission order, as the x86-64 backend buffers it before
+/// writing it out
+using Listing = std::vector<std::variant<Instruction, LabelDefinition>>;
+
+enum class PeepholeRule : std::uint8_t {
+    // push x; pop reg -> mov reg, x
+    PushPop = 0,
+    // mov/lea of a value the register already holds
+    RedundantMov,
+    // Register written and overwritten before being read
+    DeadStore,
+    // mov reg, 0 -> xor reg, reg, when the flags are dead. Rewrites, does
+    // not remove.
+    ZeroIdiom,
+    // Jump to the label right after it
+    JumpToNext,
+    Max
+};
+
+/// How many times each rule applied, indexed by PeepholeRule
+using PeepholeStats =
+  std::array<std::size_t, std::to_underlying(PeepholeRule::Max)>;
+
+/// Rewrites `listing` in place, counting what every rule did in `stats`.
+///
+/// Nothing is assumed about the code before the listing, and every register
+/// and the flags are assumed to be read after it, so a function can be
+/// optimized piecewise.
+///
+/// Calls to the runtime are known not to clobber every register, see
+/// clobbered_by() in Peephole.cpp: the runtime has to keep up with it.
+void peephole(Listing& listing, PeepholeStats& stats);
+
+[[nodiscard]] auto to_string(const PeepholeRule rule) -> std::string_view;
+
+} // namespace x86
+
+#endif // PEEPHOLE_HPP
@@ -0,0 +1,81 @@
+// Microbenchmark of the native print routine, in numbers per second. Built
+// once against each routine, see CMakeLists.txt:
+//   rack_print_bench_before  one digit per division (PrintBenchBefore.s)
+//   rack_print_bench_after   two digits at a time (PrintBenchAfter.s)
+//
+// Every range is printed 64 times over 64Ki random values, output going to
+// /dev/null; the best of 7 rounds is reported on stderr, one line per
+// range. bench/print.sh runs both and puts the medians side by side.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+enum { VALUE_COUNT = 1 << 16, PASSES = 64, ROUNDS = 7 };
+
+void flush(void);
+
+// print takes its argument in rdi, like the generated code calls it, and
+// clobbers the registers the peephole optimizer assumes it does
+static inline void print(int64_t value) {
+    __asm__ volatile("call print"
+                     : "+D"(value)
+                     :
+                     : "rax", "rcx", "rdx", "rsi", "r8", "r9", "r10", "r11",
+                       "memory", "cc");
+}
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static int64_t values[4][VALUE_COUNT];
+
+int main(void) {
+    const char* const names[] = { "0..99", "0..1e9", "0..2^63", "-1e6..0" };
+
+    const int null = open("/dev/null", O_WRONLY);
+    if (null < 0 || dup2(null, STDOUT_FILENO) < 0) {
+        perror("/dev/null");
+        return 1;
+    }
+
+    // Fixed seed, both routines print the same values
+    srand(1);
+    for (int idx = 0; idx < VALUE_COUNT; ++idx) {
+        const uint64_t random = ((uint64_t)rand() << 40)
+                                ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        values[0][idx] = (int64_t)(random % 100);
+        values[1][idx] = (int64_t)(random % 1000000000);
+        values[2][idx] = (int64_t)(random & 0x7fffffffffffffffULL);
+        values[3][idx] = -(int64_t)(random % 1000000);
+    }
+
+    for (int range = 0; range < 4; ++range) {
+        double best = 1e9;
+        for (int round = 0; round < ROUNDS; ++round) {
+            const double start = now();
+            for (int pass = 0; pass < PASSES; ++pass) {
+                for (int idx = 0; idx < VALUE_COUNT; ++idx) {
+                    print(values[range][idx]);
+                }
+            }
+            const double elapsed = now() - start;
+            if (elapsed < best) { best = elapsed; }
+        }
+        fprintf(
+          stderr,
+          "%s %.1f\n",
+          names[range],
+          (double)PASSES * VALUE_COUNT / best / 1e6
+        );
+    }
+
+    flush();
+    return 0;
+}
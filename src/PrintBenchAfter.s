@@ -0,0 +1,156 @@
+# print converting two digits at a time, for PrintBench.c: digit count
+# without branching, then two digits per division straight into the output
+# buffer, the conversion Runtime.s still does. Lifted from the -s output of
+# rack when it was introduced, with the 64 KiB output buffer it defaulted
+# to; puts, flush and write_all are the same as in PrintBenchBefore.s.
+
+    .intel_syntax noprefix
+
+    .text
+
+# print: writes rdi as a signed decimal followed by a newline
+    .globl print
+print:
+    mov r8, rdi
+    mov rdi, [rip+out_used]
+    cmp rdi, 65515
+    jbe .Lprint_room
+    call flush
+    xor edi, edi
+.Lprint_room:
+    lea rsi, [rip+out_buffer]
+    add rdi, rsi
+    test r8, r8
+    jge .Lprint_positive
+    mov BYTE PTR [rdi], 45
+    add rdi, 1
+    neg r8
+.Lprint_positive:
+    mov rcx, r8
+    or rcx, 1
+    bsr rax, rcx
+    add eax, 1
+    imul eax, 1233
+    shr eax, 12
+    lea r9, [rip+powers_of_ten]
+    sub rcx, [r9+rax*8]
+    shr rcx, 63
+    sub rax, rcx
+    add rax, 1
+    add rdi, rax
+    mov BYTE PTR [rdi], 10
+    lea r10, [rdi+1]
+    lea r9, [rip+digit_pairs]
+    mov r11, 2951479051793528259
+    mov rax, r8
+    cmp rax, 100
+    jb .Lprint_last
+.Lprint_pairs:
+    mov rcx, rax
+    shr rax, 2
+    mul r11
+    shr rdx, 2
+    mov rax, rdx
+    imul rax, 100
+    sub rcx, rax
+    mov rax, rdx
+    mov dl, [r9+rcx*2]
+    mov [rdi-2], dl
+    mov dl, [r9+rcx*2+1]
+    mov [rdi-1], dl
+    sub rdi, 2
+    cmp rax, 100
+    jae .Lprint_pairs
+.Lprint_last:
+    cmp rax, 10
+    jb .Lprint_digit
+    mov dl, [r9+rax*2]
+    mov [rdi-2], dl
+    mov dl, [r9+rax*2+1]
+    mov [rdi-1], dl
+    jmp .Lprint_written
+.Lprint_digit:
+    add eax, 48
+    mov [rdi-1], al
+.Lprint_written:
+    lea rax, [rip+out_buffer]
+    sub r10, rax
+    mov [rip+out_used], r10
+    ret
+
+# puts: appends r8 bytes starting at r9 to out_buffer
+puts:
+    mov rdi, [rip+out_used]
+    lea rax, [rdi+r8*1]
+    cmp rax, 65536
+    ja .Lputs_full
+.Lputs_append:
+    lea rsi, [rip+out_buffer]
+    add rsi, rdi
+    mov [rip+out_used], rax
+    xor ecx, ecx
+    test r8, r8
+    je .Lputs_done
+.Lputs_copy:
+    mov dl, [r9+rcx*1]
+    mov [rsi+rcx*1], dl
+    add rcx, 1
+    cmp rcx, r8
+    jb .Lputs_copy
+.Lputs_done:
+    ret
+.Lputs_full:
+    call flush
+    xor edi, edi
+    mov rax, r8
+    cmp r8, 65536
+    jbe .Lputs_append
+    mov rsi, r9
+    mov rdx, r8
+    jmp write_all
+
+# flush: writes out_buffer out and empties it, falls through to write_all
+    .globl flush
+flush:
+    lea rsi, [rip+out_buffer]
+    mov rdx, [rip+out_used]
+    mov QWORD PTR [rip+out_used], 0
+
+# write_all: writes rdx bytes starting at rsi
+write_all:
+    test rdx, rdx
+    je .Lwrite_all_done
+    mov eax, 1
+    mov edi, 1
+    syscall
+    test rax, rax
+    jle .Lwrite_all_done
+    add rsi, rax
+    sub rdx, rax
+    jmp write_all
+.Lwrite_all_done:
+    ret
+
+    .section .rodata
+    .p2align 3
+powers_of_ten:
+    .quad 1, 10, 100, 1000, 10000
+    .quad 100000, 1000000, 10000000, 100000000, 1000000000
+    .quad 10000000000, 100000000000, 1000000000000, 10000000000000
+    .quad 100000000000000, 1000000000000000, 10000000000000000
+    .quad 100000000000000000, 1000000000000000000, 10000000000000000000
+digit_pairs:
+    .ascii "0001020304050607080910111213141516171819"
+    .ascii "2021222324252627282930313233343536373839"
+    .ascii "4041424344454647484950515253545556575859"
+    .ascii "6061626364656667686970717273747576777879"
+    .ascii "8081828384858687888990919293949596979899"
+
+    .bss
+    .p2align 3
+out_used:
+    .zero 8
+out_buffer:
+    .zero 65536
+
+    .section .note.GNU-stack, "", @progbits
@@ -0,0 +1,103 @@
+# print as it was before it converted two digits at a time, for
+# PrintBench.c: one division by 10 per digit into a stack buffer, then
+# copied to the output buffer through puts. Lifted from the -s output of
+# rack at the time, with the 64 KiB output buffer it defaulted to.
+
+    .intel_syntax noprefix
+
+    .text
+
+# print: writes rdi as an unsigned decimal followed by a newline
+    .globl print
+print:
+    mov r9, -3689348814741910323
+    sub rsp, 40
+    mov BYTE PTR [rsp+31], 10
+    lea rcx, [rsp+30]
+.Lprint_digit:
+    mov rax, rdi
+    lea r8, [rsp+32]
+    mul r9
+    mov rax, rdi
+    sub r8, rcx
+    shr rdx, 3
+    lea rsi, [rdx+rdx*4]
+    add rsi, rsi
+    sub rax, rsi
+    add eax, 48
+    mov [rcx], al
+    mov rax, rdi
+    mov rdi, rdx
+    mov rdx, rcx
+    sub rcx, 1
+    cmp rax, 9
+    ja .Lprint_digit
+    lea rax, [rsp+32]
+    sub rdx, rax
+    lea rsi, [rsp+rdx*1+32]
+    mov r9, rsi
+    call puts
+    add rsp, 40
+    ret
+
+# puts: appends r8 bytes starting at r9 to out_buffer
+puts:
+    mov rdi, [rip+out_used]
+    lea rax, [rdi+r8*1]
+    cmp rax, 65536
+    ja .Lputs_full
+.Lputs_append:
+    lea rsi, [rip+out_buffer]
+    add rsi, rdi
+    mov [rip+out_used], rax
+    xor ecx, ecx
+    test r8, r8
+    je .Lputs_done
+.Lputs_copy:
+    mov dl, [r9+rcx*1]
+    mov [rsi+rcx*1], dl
+    add rcx, 1
+    cmp rcx, r8
+    jb .Lputs_copy
+.Lputs_done:
+    ret
+.Lputs_full:
+    call flush
+    xor edi, edi
+    mov rax, r8
+    cmp r8, 65536
+    jbe .Lputs_append
+    mov rsi, r9
+    mov rdx, r8
+    jmp write_all
+
+# flush: writes out_buffer out and empties it, falls through to write_all
+    .globl flush
+flush:
+    lea rsi, [rip+out_buffer]
+    mov rdx, [rip+out_used]
+    mov QWORD PTR [rip+out_used], 0
+
+# write_all: writes rdx bytes starting at rsi
+write_all:
+    test rdx, rdx
+    je .Lwrite_all_done
+    mov eax, 1
+    mov edi, 1
+    syscall
+    test rax, rax
+    jle .Lwrite_all_done
+    add rsi, rax
+    sub rdx, rax
+    jmp write_all
+.Lwrite_all_done:
+    ret
+
+    .bss
+    .p2align 3
+out_used:
+    .zero 8
+out_buffer:
+    .zero 65536
+
+    .section .note.GNU-stack, "", @progbits
@@ -0,0 +1,249 @@
+# Native runtime of rack programs, assembled once into librack_rt.a and
+# linked into every executable: the print and puts builtins, and the _start
+# entry point calling func_main.
+#
+# Output is gathered in out_buffer, written out when full and before
+# exiting. The buffer and its settings come with the program, see
+# Assembler_x86_64::generate_data_section():
+#   out_capacity          qword, bytes of out_buffer to use, 0 writes the
+#                         output of every call right away
+#   out_flush_on_newline  byte, also write every line out as it ends when
+#                         stdout is a terminal
+#   out_buffer            out_capacity bytes, and at least 21: print writes
+#                         straight into it
+#
+# The generated code counts on these registers being kept, see
+# clobbered_by() in Peephole.cpp: puts only clobbers rax, rcx, rdx, rsi,
+# rdi, r10 and r11, print clobbers r8 and r9 as well.
+#
+# Every routine and table has a section of its own, the linker drops the
+# ones the program does not use (--gc-sections).
+
+    .intel_syntax noprefix
+
+# print: writes rdi as a signed decimal followed by a newline
+    .section .text.print, "ax", @progbits
+    .globl print
+    .type print, @function
+    .p2align 4
+print:
+    mov r8, rdi
+    mov rdi, QWORD PTR [rip + out_used]
+    lea rax, [rdi + 21]
+    cmp rax, QWORD PTR [rip + out_capacity]
+    jbe .Lprint_room
+    call flush
+    xor edi, edi
+.Lprint_room:
+    lea rsi, [rip + out_buffer]
+    add rdi, rsi
+    test r8, r8
+    jge .Lprint_positive
+    mov BYTE PTR [rdi], '-'
+    add rdi, 1
+    neg r8
+.Lprint_positive:
+    # Digit count, without branching: the bit length times 1233 / 4096 is
+    # log10 or one less, t, and the count is t + 1 - (v < 10^t). v is at
+    # most 2^63 (a negated INT64_MIN) and 10^t at most 2v, so the sign of
+    # v - 10^t tells. Or'ing 1 in gives 0 its digit.
+    mov rcx, r8
+    or rcx, 1
+    bsr rax, rcx
+    add eax, 1
+    imul eax, eax, 1233
+    shr eax, 12
+    lea r9, [rip + powers_of_ten]
+    sub rcx, QWORD PTR [r9 + rax * 8]
+    shr rcx, 63
+    sub rax, rcx
+    add rax, 1
+    # Written backwards from the newline, two digits per division
+    add rdi, rax
+    mov BYTE PTR [rdi], 10
+    lea r10, [rdi + 1]
+    lea r9, [rip + digit_pairs]
+    movabs r11, 0x28F5C28F5C28F5C3
+    mov rax, r8
+    cmp rax, 100
+    jb .Lprint_last
+.Lprint_pairs:
+    # rdx = rax / 100, as ((rax >> 2) * ceil(2^66 / 100)) >> 66
+    mov rcx, rax
+    shr rax, 2
+    mul r11
+    shr rdx, 2
+    mov rax, rdx
+    imul rax, rax, 100
+    sub rcx, rax
+    mov rax, rdx
+    mov dl, BYTE PTR [r9 + rcx * 2]
+    mov BYTE PTR [rdi - 2], dl
+    mov dl, BYTE PTR [r9 + rcx * 2 + 1]
+    mov BYTE PTR [rdi - 1], dl
+    sub rdi, 2
+    cmp rax, 100
+    jae .Lprint_pairs
+.Lprint_last:
+    cmp rax, 10
+    jb .Lprint_digit
+    mov dl, BYTE PTR [r9 + rax * 2]
+    mov BYTE PTR [rdi - 2], dl
+    mov dl, BYTE PTR [r9 + rax * 2 + 1]
+    mov BYTE PTR [rdi - 1], dl
+    jmp .Lprint_written
+.Lprint_digit:
+    add eax, '0'
+    mov BYTE PTR [rdi - 1], al
+.Lprint_written:
+    lea rax, [rip + out_buffer]
+    sub r10, rax
+    mov QWORD PTR [rip + out_used], r10
+    # Past the capacity only when unbuffered
+    cmp r10, QWORD PTR [rip + out_capacity]
+    ja flush
+    cmp BYTE PTR [rip + out_tty], 0
+    jne flush
+    ret
+    .size print, . - print
+
+# puts: appends r8 bytes starting at r9 to out_buffer
+    .section .text.puts, "ax", @progbits
+    .globl puts
+    .type puts, @function
+    .p2align 4
+puts:
+    mov rdi, QWORD PTR [rip + out_used]
+    lea rax, [rdi + r8]
+    cmp rax, QWORD PTR [rip + out_capacity]
+    ja .Lputs_full
+.Lputs_append:
+    lea rsi, [rip + out_buffer]
+    add rsi, rdi
+    mov QWORD PTR [rip + out_used], rax
+    xor ecx, ecx
+    test r8, r8
+    je .Lputs_done
+.Lputs_copy:
+    mov dl, BYTE PTR [r9 + rcx]
+    mov BYTE PTR [rsi + rcx], dl
+    add rcx, 1
+    cmp rcx, r8
+    jb .Lputs_copy
+    # Line buffered on a terminal: flushed if a newline was appended
+    cmp BYTE PTR [rip + out_tty], 0
+    je .Lputs_done
+    xor ecx, ecx
+.Lputs_scan:
+    cmp BYTE PTR [r9 + rcx], 10
+    je flush
+    add rcx, 1
+    cmp rcx, r8
+    jb .Lputs_scan
+.Lputs_done:
+    ret
+.Lputs_full:
+    call flush
+    xor edi, edi
+    mov rax, r8
+    cmp r8, QWORD PTR [rip + out_capacity]
+    jbe .Lputs_append
+    # Larger than the whole buffer, written as is
+    mov rsi, r9
+    mov rdx, r8
+    jmp write_all
+    .size puts, . - puts
+
+# flush: writes out_buffer out and empties it, keeps r8 and r9
+    .section .text.flush, "ax", @progbits
+    .type flush, @function
+    .p2align 4
+flush:
+    lea rsi, [rip + out_buffer]
+    mov rdx, QWORD PTR [rip + out_used]
+    mov QWORD PTR [rip + out_used], 0
+    # Falls through to write_all
+    .size flush, . - flush
+
+# write_all: writes rdx bytes starting at rsi, until done or an error (the
+# rest is lost), keeps r8 and r9
+    .type write_all, @function
+write_all:
+    test rdx, rdx
+    je .Lwrite_all_done
+    mov eax, 1
+    mov edi, 1
+    syscall
+    test rax, rax
+    jle .Lwrite_all_done
+    add rsi, rax
+    sub rdx, rax
+    jmp write_all
+.Lwrite_all_done:
+    ret
+    .size write_all, . - write_all
+
+    .section .text._start, "ax", @progbits
+    .globl _start
+    .type _start, @function
+    .p2align 4
+_start:
+    cmp BYTE PTR [rip + out_flush_on_newline], 0
+    je .Lstart_run
+    # stdout is a terminal if ioctl(1, TCGETS, &termios) succeeds
+    sub rsp, 64
+    mov eax, 16
+    mov edi, 1
+    mov esi, 0x5401
+    mov rdx, rsp
+    syscall
+    add rsp, 64
+    test rax, rax
+    jne .Lstart_run
+    mov BYTE PTR [rip + out_tty], 1
+.Lstart_run:
+    call func_main
+    call flush
+    mov eax, 60
+    xor edi, edi
+    syscall
+    .size _start, . - _start
+
+# 10^0 to 10^19, print counts digits against them
+    .section .rodata.powers_of_ten, "a", @progbits
+    .p2align 3
+    .type powers_of_ten, @object
+powers_of_ten:
+    .quad 1, 10, 100, 1000, 10000
+    .quad 100000, 1000000, 10000000, 100000000, 1000000000
+    .quad 10000000000, 100000000000, 1000000000000, 10000000000000
+    .quad 100000000000000, 1000000000000000, 10000000000000000
+    .quad 100000000000000000, 1000000000000000000, 10000000000000000000
+    .size powers_of_ten, . - powers_of_ten
+
+# "00" to "99" back to back, print converts two digits at a time
+    .section .rodata.digit_pairs, "a", @progbits
+    .type digit_pairs, @object
+digit_pairs:
+    .ascii "0001020304050607080910111213141516171819"
+    .ascii "2021222324252627282930313233343536373839"
+    .ascii "4041424344454647484950515253545556575859"
+    .ascii "6061626364656667686970717273747576777879"
+    .ascii "8081828384858687888990919293949596979899"
+    .size digit_pairs, . - digit_pairs
+
+    .bss
+    .p2align 3
+
+    .type out_used, @object
+out_used:
+    .zero 8
+    .size out_used, . - out_used
+
+# Set by _start when stdout is a terminal and lines are flushed as they end
+    .type out_tty, @object
+out_tty:
+    .zero 1
+    .size out_tty, . - out_tty
+
+    .section .note.GNU-stack, "", @progbits
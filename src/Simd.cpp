@@ -0,0 +1,265 @@
+#include "Simd.hpp"
+#include "LexerTables.hpp"
+
+#include <bit>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+auto skip_whitespace_scalar(const char* cursor, const char* end)
+  -> const char* {
+    while (cursor < end
+           && lexer_tables::class_of(*cursor)
+                == lexer_tables::CharClass::Whitespace) {
+        ++cursor;
+    }
+    return cursor;
+}
+
+auto skip_identifier_scalar(const char* cursor, const char* end)
+  -> const char* {
+    while (cursor < end
+           && lexer_tables::loops(lexer_tables::State::Identifier, *cursor)) {
+        ++cursor;
+    }
+    return cursor;
+}
+
+auto skip_string_contents_scalar(const char* cursor, const char* end)
+  -> const char* {
+    while (cursor < end
+           && lexer_tables::loops(lexer_tables::State::String, *cursor)) {
+        ++cursor;
+    }
+    return cursor;
+}
+
+#if defined(__x86_64__)
+
+// The kernels compute a mask of the bytes that *stop* the run, so the
+// result is always the lowest set bit.
+//
+// Unsigned range checks are done as `min(x - lo, hi - lo) == x - lo`, as
+// SSE2/AVX2 only have signed byte comparisons.
+
+auto skip_whitespace_sse2(const char* cursor, const char* end) -> const char* {
+    const auto space = _mm_set1_epi8(' ');
+    const auto tab   = _mm_set1_epi8('\t');
+    const auto four  = _mm_set1_epi8(4);
+
+    while (end - cursor >= 16) {
+        const auto chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+        // '\t', '\n', '\v', '\f', '\r' are the contiguous range 9..13
+        const auto control = _mm_sub_epi8(chunk, tab);
+        const auto is_whitespace = _mm_or_si128(
+          _mm_cmpeq_epi8(chunk, space),
+          _mm_cmpeq_epi8(_mm_min_epu8(control, four), control)
+        );
+
+        const auto stop =
+          ~static_cast<unsigned>(_mm_movemask_epi8(is_whitespace)) & 0xFFFFU;
+        if (stop != 0) { return cursor + std::countr_zero(stop); }
+        cursor += 16;
+    }
+
+    return skip_whitespace_scalar(cursor, end);
+}
+
+auto skip_identifier_sse2(const char* cursor, const char* end) -> const char* {
+    const auto lower_a    = _mm_set1_epi8('a');
+    const auto zero       = _mm_set1_epi8('0');
+    const auto underscore = _mm_set1_epi8('_');
+    const auto case_bit   = _mm_set1_epi8(0x20);
+    const auto letters    = _mm_set1_epi8(25);
+    const auto digits     = _mm_set1_epi8(9);
+
+    while (end - cursor >= 16) {
+        const auto chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+        const auto letter =
+          _mm_sub_epi8(_mm_or_si128(chunk, case_bit), lower_a);
+        const auto digit = _mm_sub_epi8(chunk, zero);
+
+        const auto is_identifier = _mm_or_si128(
+          _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_min_epu8(letter, letters), letter),
+            _mm_cmpeq_epi8(_mm_min_epu8(digit, digits), digit)
+          ),
+          _mm_cmpeq_epi8(chunk, underscore)
+        );
+
+        const auto stop =
+          ~static_cast<unsigned>(_mm_movemask_epi8(is_identifier)) & 0xFFFFU;
+        if (stop != 0) { return cursor + std::countr_zero(stop); }
+        cursor += 16;
+    }
+
+    return skip_identifier_scalar(cursor, end);
+}
+
+auto skip_string_contents_sse2(const char* cursor, const char* end)
+  -> const char* {
+    const auto quote     = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto sentinel  = _mm_setzero_si128();
+
+    while (end - cursor >= 16) {
+        const auto chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+        const auto is_special = _mm_or_si128(
+          _mm_or_si128(
+            _mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)
+          ),
+          _mm_cmpeq_epi8(chunk, sentinel)
+        );
+
+        const auto stop = static_cast<unsigned>(_mm_movemask_epi8(is_special));
+        if (stop != 0) { return cursor + std::countr_zero(stop); }
+        cursor += 16;
+    }
+
+    return skip_string_contents_scalar(cursor, end);
+}
+
+__attribute__((target("avx2"))) auto
+  skip_whitespace_avx2(const char* cursor, const char* end) -> const char* {
+    const auto space = _mm256_set1_epi8(' ');
+    const auto tab   = _mm256_set1_epi8('\t');
+    const auto four  = _mm256_set1_epi8(4);
+
+    while (end - cursor >= 32) {
+        const auto chunk =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+        const auto control       = _mm256_sub_epi8(chunk, tab);
+        const auto is_whitespace = _mm256_or_si256(
+          _mm256_cmpeq_epi8(chunk, space),
+          _mm256_cmpeq_epi8(_mm256_min_epu8(control, four), control)
+        );
+
+        const auto stop =
+          ~static_cast<std::uint32_t>(_mm256_movemask_epi8(is_whitespace));
+        if (stop != 0) { return cursor + std::countr_zero(stop); }
+        cursor += 32;
+    }
+
+    return skip_whitespace_sse2(cursor, end);
+}
+
+__attribute__((target("avx2"))) auto
+  skip_identifier_avx2(const char* cursor, const char* end) -> const char* {
+    const auto lower_a    = _mm256_set1_epi8('a');
+    const auto zero       = _mm256_set1_epi8('0');
+    const auto underscore = _mm256_set1_epi8('_');
+    const auto case_bit   = _mm256_set1_epi8(0x20);
+    const auto letters    = _mm256_set1_epi8(25);
+    const auto digits     = _mm256_set1_epi8(9);
+
+    while (end - cursor >= 32) {
+        const auto chunk =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+        const auto letter =
+          _mm256_sub_epi8(_mm256_or_si256(chunk, case_bit), lower_a);
+        const auto digit = _mm256_sub_epi8(chunk, zero);
+
+        const auto is_identifier = _mm256_or_si256(
+          _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(letter, letters), letter),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(digit, digits), digit)
+          ),
+          _mm256_cmpeq_epi8(chunk, underscore)
+        );
+
+        const auto stop =
+          ~static_cast<std::uint32_t>(_mm256_movemask_epi8(is_identifier));
+        if (stop != 0) { return cursor + std::countr_zero(stop); }
+        cursor += 32;
+    }
+
+    return skip_identifier_sse2(cursor, end);
+}
+
+__attribute__((target("avx2"))) auto
+  skip_string_contents_avx2(const char* cursor, const char* end)
+    -> const char* {
+    const auto quote     = _mm256_set1_epi8('"');
+    const auto backslash = _mm256_set1_epi8('\\');
+    const auto sentinel  = _mm256_setzero_si256();
+
+    while (end - cursor >= 32) {
+        const auto chunk =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+        const auto is_special = _mm256_or_si256(
+          _mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)
+          ),
+          _mm256_cmpeq_epi8(chunk, sentinel)
+        );
+
+        const auto stop =
+          static_cast<std::uint32_t>(_mm256_movemask_epi8(is_special));
+        if (stop != 0) { return cursor + std::countr_zero(stop); }
+        cursor += 32;
+    }
+
+    return skip_string_contents_sse2(cursor, end);
+}
+
+#endif
+
+using ScanFunction = auto (*)(const char*, const char*) -> const char*;
+
+struct Kernels {
+    const char*  name;
+    ScanFunction whitespace;
+    ScanFunction identifier;
+    ScanFunction string_contents;
+};
+
+auto select_kernels() -> Kernels {
+#if defined(__x86_64__)
+    // We may run before libgcc's own constructor initialised the cpu model
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return { "avx2",
+                 skip_whitespace_avx2,
+                 skip_identifier_avx2,
+                 skip_string_contents_avx2 };
+    }
+    return { "sse2",
+             skip_whitespace_sse2,
+             skip_identifier_sse2,
+             skip_string_contents_sse2 };
+#else
+    return { "scalar",
+             skip_whitespace_scalar,
+             skip_identifier_scalar,
+             skip_string_contents_scalar };
+#endif
+}
+
+const Kernels kernels = select_kernels();
+
+} // namespace
+
+namespace simd {
+
+auto skip_whitespace(const char* cursor, const char* end) -> const char* {
+    return kernels.whitespace(cursor, end);
+}
+
+auto skip_identifier(const char* cursor, const char* end) -> const char* {
+    return kernels.identifier(cursor, end);
+}
+
+auto skip_string_contents(const char* cursor, const char* end)
+  -> const char* {
+    return kernels.string_contents(cursor, end);
+}
+
+auto implementation() -> const char* { return kernels.name; }
+
+} // namespace simd
@@ -0,0 +1,30 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+/// Vectorised scanning kernels for the lexer hot loops.
+///
+/// Every function returns a pointer to the first byte in [cursor, end) that
+/// does not belong to the scanned run, or `end` if there is none. The
+/// implementation is picked once at startup: AVX2 when the CPU supports it,
+/// SSE2 otherwise, and a table-driven scalar loop for the tails and for
+/// non x86-64 targets. The byte sets match the lexer_tables exactly.
+namespace simd {
+
+/// Skips whitespace: ' ', '\t', '\n', '\v', '\f', '\r'
+[[nodiscard]] auto skip_whitespace(const char* cursor, const char* end)
+  -> const char*;
+
+/// Skips identifier characters: [A-Za-z0-9_]
+[[nodiscard]] auto skip_identifier(const char* cursor, const char* end)
+  -> const char*;
+
+/// Skips string literal contents, stopping on '"', '\\' or '\0'
+[[nodiscard]] auto skip_string_contents(const char* cursor, const char* end)
+  -> const char*;
+
+/// Name of the selected implementation, for diagnostics
+[[nodiscard]] auto implementation() -> const char*;
+
+} // namespace simd
+
+#endif // SIMD_HPP
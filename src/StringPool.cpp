@@ -0,0 +1,151 @@
+#include "StringPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <numeric>
+#include <span>
+
+namespace {
+
+/// Appends the byte spelled by the leading digits of `digits`, returns how
+/// many digits were used
+auto parse_digits(
+  const std::string_view digits,
+  const int              base,
+  std::string&           decoded
+) -> std::size_t {
+    unsigned   value  = 0;
+    const auto result = std::from_chars(
+      digits.data(), digits.data() + digits.size(), value, base
+    );
+    decoded.push_back(static_cast<char>(value));
+    return static_cast<std::size_t>(result.ptr - digits.data());
+}
+
+} // namespace
+
+auto StringPool::intern(const std::string_view bytes) -> Id {
+    const auto found = this->m_ids.find(bytes);
+    if (found != this->m_ids.end()) { return found->second; }
+
+    const auto stored = this->m_storage.copy(std::span<const char>(bytes));
+    const auto id     = static_cast<Id>(this->m_strings.size());
+    this->m_strings.emplace_back(stored.data(), stored.size());
+    this->m_ids.emplace(this->m_strings.back(), id);
+    return id;
+}
+
+auto StringPool::get(const Id id) const -> std::string_view {
+    return this->m_strings[id];
+}
+
+auto StringPool::count() const -> std::size_t { return this->m_strings.size(); }
+
+auto StringPool::layout() const -> Layout {
+    const auto& strings = this->m_strings;
+
+    // Sorted by their reversed bytes, the strings ending with a given one
+    // directly follow it
+    std::vector<Id> order(strings.size());
+    std::iota(order.begin(), order.end(), Id{ 0 });
+    std::ranges::sort(order, [&](const Id lhs, const Id rhs) {
+        return std::lexicographical_compare(
+          strings[lhs].rbegin(),
+          strings[lhs].rend(),
+          strings[rhs].rbegin(),
+          strings[rhs].rend()
+        );
+    });
+
+    // The string each one is stored in: itself, or the longest one it ends
+    std::vector<Id> host(strings.size());
+    for (auto idx = order.size(); idx-- > 0;) {
+        const auto id = order[idx];
+        host[id]      = id;
+        if (idx + 1 == order.size()) { continue; }
+
+        const auto next = host[order[idx + 1]];
+        if (strings[next].ends_with(strings[id])) { host[id] = next; }
+    }
+
+    Layout layout;
+    layout.offsets.resize(strings.size());
+    for (Id id = 0; id < strings.size(); ++id) {
+        if (host[id] != id) { continue; }
+        layout.offsets[id] = static_cast<std::uint32_t>(layout.bytes.size());
+        layout.bytes.append(strings[id]);
+    }
+    for (Id id = 0; id < strings.size(); ++id) {
+        if (host[id] == id) { continue; }
+        layout.offsets[id] = layout.offsets[host[id]]
+                             + static_cast<std::uint32_t>(
+                               strings[host[id]].size() - strings[id].size()
+                             );
+    }
+
+    return layout;
+}
+
+auto decode_escapes(const std::string_view literal) -> std::string {
+    std::string decoded;
+    decoded.reserve(literal.size());
+
+    for (std::size_t idx = 0; idx < literal.size(); ++idx) {
+        if (literal[idx] != '\\' || idx + 1 == literal.size()) {
+            decoded.push_back(literal[idx]);
+            continue;
+        }
+
+        const char escaped = literal[++idx];
+        switch (escaped) {
+            case 'n': {
+                decoded.push_back('\n');
+                break;
+            }
+            case 't': {
+                decoded.push_back('\t');
+                break;
+            }
+            case 'r': {
+                decoded.push_back('\r');
+                break;
+            }
+            case 'a': {
+                decoded.push_back('\a');
+                break;
+            }
+            case 'b': {
+                decoded.push_back('\b');
+                break;
+            }
+            case 'f': {
+                decoded.push_back('\f');
+                break;
+            }
+            case 'v': {
+                decoded.push_back('\v');
+                break;
+            }
+            case 'e': {
+                decoded.push_back('\x1B');
+                break;
+            }
+            case 'x': {
+                // Up to two hexadecimal digits
+                idx += parse_digits(literal.substr(idx + 1, 2), 16, decoded);
+                break;
+            }
+            default: {
+                // Up to three octal digits
+                if (escaped >= '0' && escaped <= '7') {
+                    idx += parse_digits(literal.substr(idx, 3), 8, decoded) - 1;
+                    break;
+                }
+                // \\, \", \' and \` stand for themselves
+                decoded.push_back(escaped);
+            }
+        }
+    }
+
+    return decoded;
+}
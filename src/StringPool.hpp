@@ -0,0 +1,49 @@
+#ifndef STRING_POOL_HPP
+#define STRING_POOL_HPP
+
+#include "Arena.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// The strings of a program, as the bytes written at runtime: escapes are
+/// decoded once, when a literal is added, and identical strings are only
+/// stored once.
+class StringPool {
+  public:
+    using Id = std::uint32_t;
+
+    /// The strings back to back, as they go to .rodata
+    struct Layout {
+        std::string                bytes;
+        // Where each string starts in `bytes`, indexed by Id
+        std::vector<std::uint32_t> offsets;
+    };
+
+    /// Adds `bytes`, unless an identical string was already added, and
+    /// returns its id
+    [[nodiscard]] auto intern(const std::string_view bytes) -> Id;
+
+    [[nodiscard]] auto get(const Id id) const -> std::string_view;
+    [[nodiscard]] auto count() const -> std::size_t;
+
+    /// Lays out every string. One that ends another one is not stored again,
+    /// it starts inside the other string.
+    [[nodiscard]] auto layout() const -> Layout;
+
+  private:
+    std::vector<std::string_view>            m_strings;
+    std::unordered_map<std::string_view, Id> m_ids;
+    Arena                                    m_storage;
+};
+
+/// Decodes the escapes of a string literal, as written in the source: \n,
+/// \t, \r, \a, \b, \f, \v, \e, \xHH (up to two hexadecimal digits), \OOO (up
+/// to three octal digits). Any other escaped character stands for itself.
+[[nodiscard]] auto decode_escapes(const std::string_view literal)
+  -> std::string;
+
+#endif // STRING_POOL_HPP
@@ -1,20 +1,54 @@
 #include "Utility.hpp"
 
+auto FileTable::intern(const std::string_view path) -> std::uint32_t {
+    auto& table = this->m_entries;
+
+    for (std::size_t idx = 0; idx < table.size(); ++idx) {
+        if (table[idx].path == path) { return static_cast<std::uint32_t>(idx); }
+    }
+
+    table.push_back(Entry{ std::string(path), {} });
+    return static_cast<std::uint32_t>(table.size() - 1);
+}
+
+void FileTable::set_contents(
+  const std::uint32_t    file_id,
+  const std::string_view contents
+) {
+    this->m_entries.at(file_id).contents = contents;
+}
+
+auto FileTable::path(const std::uint32_t file_id) const -> std::string_view {
+    return this->m_entries.at(file_id).path;
+}
+
+auto FileTable::contents(const std::uint32_t file_id) const
+  -> std::string_view {
+    return this->m_entries.at(file_id).contents;
+}
+
 auto Span::create(
-  const std::string& file_id,
-  const std::size_t  start,
-  const std::size_t  end
+  const std::uint32_t file_id,
+  const std::size_t   start,
+  const std::size_t   end
 ) -> Span {
-    return { file_id, start, end };
+    // Sources are capped at 4GiB by the Compiler, so offsets always fit
+    return { file_id,
+             static_cast<std::uint32_t>(start),
+             static_cast<std::uint32_t>(end) };
 }
 
-auto Span::file_id() const -> std::string { return this->m_file_id; }
+auto Span::file_id() const -> std::uint32_t { return this->m_file_id; }
 
 auto Span::start() const -> std::size_t { return this->m_start; }
 
 auto Span::end() const -> std::size_t { return this->m_end; }
 
-Span::Span(std::string file_id, const std::size_t start, const std::size_t end)
-  : m_file_id{ std::move(file_id) },
+Span::Span(
+  const std::uint32_t file_id,
+  const std::uint32_t start,
+  const std::uint32_t end
+)
+  : m_file_id{ file_id },
     m_start{ start },
     m_end{ end } {}
@@ -4,46 +4,61 @@
 #define FMT_HEADER_ONLY
 
 #include <cstdint>
+#include <deque>
 #include <fmt/format.h>
+#include <string>
+#include <string_view>
+
+/// Interned table of the files taking part in a compilation, owned by its
+/// Compiler. Spans and tokens only carry the 32-bit index, paths and
+/// contents are resolved lazily when something is actually printed. Files
+/// are registered by the Compiler before lexing starts, lookups afterwards
+/// are read-only.
+class FileTable {
+  public:
+    [[nodiscard]] auto intern(const std::string_view path) -> std::uint32_t;
+    void set_contents(
+      const std::uint32_t    file_id,
+      const std::string_view contents
+    );
+
+    [[nodiscard]] auto path(const std::uint32_t file_id) const
+      -> std::string_view;
+    [[nodiscard]] auto contents(const std::uint32_t file_id) const
+      -> std::string_view;
+
+  private:
+    struct Entry {
+        std::string      path;
+        std::string_view contents;
+    };
+
+    // std::deque keeps references stable while new files get registered
+    std::deque<Entry> m_entries;
+};
 
 class Span {
   public:
     [[nodiscard]] static auto create(
-      const std::string& file_id,
-      const std::size_t  start,
-      const std::size_t  end
+      const std::uint32_t file_id,
+      const std::size_t   start,
+      const std::size_t   end
     ) -> Span;
 
-    [[nodiscard]] auto file_id() const -> std::string;
+    [[nodiscard]] auto file_id() const -> std::uint32_t;
     [[nodiscard]] auto start() const -> std::size_t;
     [[nodiscard]] auto end() const -> std::size_t;
 
   private:
-    Span(std::string file_id, const std::size_t start, const std::size_t end);
-
-    std::string m_file_id;
-    std::size_t m_start;
-    std::size_t m_end;
-};
+    Span(
+      const std::uint32_t file_id,
+      const std::uint32_t start,
+      const std::uint32_t end
+    );
 
-// {fmt} Custom Formatters
-template<>
-struct fmt::formatter<Span> {
-    template<typename ParseContext>
-    constexpr auto parse(ParseContext& ctx) {
-        return ctx.begin();
-    }
-
-    template<typename FormatContext>
-    auto format(const Span& span, FormatContext& ctx) {
-        return fmt::format_to(
-          ctx.out(),
-          "Span {{ file_id: {}, start: {}, end: {} }}",
-          span.file_id(),
-          span.start(),
-          span.end()
-        );
-    }
+    std::uint32_t m_file_id;
+    std::uint32_t m_start;
+    std::uint32_t m_end;
 };
 
 #endif // UTILITY_HPP
@@ -0,0 +1,214 @@
+#include "Vm.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+
+namespace vm {
+
+auto Vm::create(bytecode::Program program) -> std::expected<Vm, VmError> {
+    if (!program.entry.has_value()) {
+        return std::unexpected(VmError::MissingMain);
+    }
+
+    Vm machine(std::move(program));
+
+    const auto result = machine.translate();
+    if (!result.has_value()) { return std::unexpected(result.error()); }
+
+    return machine;
+}
+
+Vm::Vm(bytecode::Program program)
+  : m_program{ std::move(program) },
+    m_pool(m_program.strings.begin(), m_program.strings.end()),
+    m_stack(Vm::stack_capacity, 0) {}
+
+auto Vm::translate() -> std::expected<void, VmError> {
+    using bytecode::Opcode;
+
+    static_assert(
+      std::to_underlying(Opcode::Max) == 8,
+      "[INTERNAL ERROR] vm::Vm::translate() requires to handle all opcodes"
+    );
+
+    const auto* handlers = this->execute(nullptr);
+    const auto& code     = this->m_program.code;
+
+    // Functions are straight-line code ending with Return, so the stack
+    // depth at every instruction is known by walking them in order
+    std::size_t depth = 0;
+    std::size_t pc    = 0;
+    while (pc < code.size()) {
+        if (pc == this->m_program.entry) {
+            this->m_entry = this->m_code.size();
+        }
+
+        const auto opcode = static_cast<Opcode>(code[pc]);
+        if (opcode >= Opcode::Max
+            || pc + 1 + bytecode::operand_size(opcode) > code.size()) {
+            return std::unexpected(VmError::InvalidBytecode);
+        }
+        this->m_code.push_back(
+          Cell{ .handler = handlers[std::to_underlying(opcode)] }
+        );
+
+        std::uint64_t operand = 0;
+        for (std::size_t byte = 0; byte < bytecode::operand_size(opcode);
+             ++byte) {
+            operand |= static_cast<std::uint64_t>(code[pc + 1 + byte])
+                       << (8U * byte);
+        }
+
+        switch (opcode) {
+            case Opcode::PushInteger:
+            case Opcode::PushString: {
+                // A string may be empty, so may start at the end
+                if (opcode == Opcode::PushString
+                    && operand > this->m_pool.size()) {
+                    return std::unexpected(VmError::InvalidBytecode);
+                }
+
+                depth += 1;
+                if (depth > Vm::stack_capacity) {
+                    return std::unexpected(VmError::StackOverflow);
+                }
+                this->m_code.push_back(Cell{
+                  .value = opcode == Opcode::PushString
+                             ? reinterpret_cast<std::uintptr_t>(
+                                 this->m_pool.data() + operand
+                               )
+                             : operand,
+                });
+                break;
+            }
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul: {
+                if (depth < 2) {
+                    return std::unexpected(VmError::StackUnderflow);
+                }
+                depth -= 1;
+                break;
+            }
+            case Opcode::Print: {
+                if (depth < 1) {
+                    return std::unexpected(VmError::StackUnderflow);
+                }
+                depth -= 1;
+                break;
+            }
+            case Opcode::Puts: {
+                if (depth < 2) {
+                    return std::unexpected(VmError::StackUnderflow);
+                }
+                depth -= 2;
+                break;
+            }
+            case Opcode::Return: {
+                // Values left behind are dropped along with the frame
+                depth = 0;
+                break;
+            }
+            default: {
+                return std::unexpected(VmError::InvalidBytecode);
+            }
+        }
+
+        pc += 1 + bytecode::operand_size(opcode);
+    }
+
+    return {};
+}
+
+void Vm::run() {
+    this->execute(this->m_code.data() + this->m_entry);
+    this->flush();
+}
+
+// Computed goto (`&&label`, `goto *`) is a GNU extension
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+auto Vm::execute(const Cell* pc) -> const void* const* {
+    static const void* const handlers[] = {
+        &&push,
+        &&push,
+        &&add,
+        &&sub,
+        &&mul,
+        &&print,
+        &&puts,
+        &&return_,
+    };
+    static_assert(
+      std::size(handlers) == std::to_underlying(bytecode::Opcode::Max),
+      "[INTERNAL ERROR] vm::Vm::execute() requires a handler per opcode"
+    );
+
+    if (pc == nullptr) { return handlers; }
+
+    auto* sp = this->m_stack.data();
+    goto *(pc++)->handler;
+
+push:
+    // Strings are pushed by address, resolved while translating
+    *(sp++) = (pc++)->value;
+    goto *(pc++)->handler;
+
+add:
+    --sp;
+    sp[-1] += *sp;
+    goto *(pc++)->handler;
+
+sub:
+    --sp;
+    sp[-1] -= *sp;
+    goto *(pc++)->handler;
+
+mul:
+    --sp;
+    sp[-1] *= *sp;
+    goto *(pc++)->handler;
+
+print: {
+    --sp;
+    const fmt::format_int digits(static_cast<std::int64_t>(*sp));
+    this->m_output.append(digits.data(), digits.data() + digits.size());
+    this->m_output.push_back('\n');
+    if (this->m_output.size() >= Vm::flush_threshold) { this->flush(); }
+    goto *(pc++)->handler;
+}
+
+puts:
+    sp -= 2;
+    this->write(reinterpret_cast<const char*>(sp[1]), sp[0]);
+    goto *(pc++)->handler;
+
+return_:
+    // There are no calls yet, returning always leaves main
+    return handlers;
+}
+
+#pragma GCC diagnostic pop
+
+void Vm::write(const char* data, const std::size_t size) {
+    // Addresses only ever come from the pool, and a size running past a
+    // string reads into the following ones, like it does natively. Nothing
+    // past the pool is ever read.
+    const auto* pool_begin = this->m_pool.data();
+    const auto* pool_end   = pool_begin + this->m_pool.size();
+    if (data < pool_begin || data > pool_end) { return; }
+
+    const auto available = static_cast<std::size_t>(pool_end - data);
+    this->m_output.append(data, data + std::min(size, available));
+    if (this->m_output.size() >= Vm::flush_threshold) { this->flush(); }
+}
+
+void Vm::flush() {
+    std::fwrite(this->m_output.data(), 1, this->m_output.size(), stdout);
+    std::fflush(stdout);
+    this->m_output.clear();
+}
+
+} // namespace vm
@@ -0,0 +1,115 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#define FMT_HEADER_ONLY
+
+#include "Bytecode.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fmt/format.h>
+#include <utility>
+#include <vector>
+
+/// Direct-threaded interpreter for bytecode::Program.
+///
+/// The bytecode is translated once into threaded code, where every
+/// instruction is the address of its handler followed by its operands, so
+/// dispatching is a single indirect jump (GCC's computed goto). Stack usage
+/// is checked while translating, the handlers themselves never do.
+namespace vm {
+
+enum class VmError : std::uint8_t {
+    MissingMain = 0,
+    InvalidBytecode,
+    StackUnderflow,
+    StackOverflow,
+    Max
+};
+
+class Vm {
+  public:
+    // Operand stack size, in values
+    static constexpr std::size_t stack_capacity = 1UL << 16U;
+
+    [[nodiscard]] static auto create(bytecode::Program program)
+      -> std::expected<Vm, VmError>;
+
+    /// Runs `main`, output is flushed on return
+    void run();
+
+  private:
+    union Cell {
+        const void*   handler;
+        std::uint64_t value;
+    };
+
+    explicit Vm(bytecode::Program program);
+
+    /// Translates m_program into m_code, checking every stack access
+    [[nodiscard]] auto translate() -> std::expected<void, VmError>;
+
+    /// Runs the threaded code at `pc`, or returns the handler table (indexed
+    /// by opcode) when `pc` is null
+    auto execute(const Cell* pc) -> const void* const*;
+
+    void write(const char* data, const std::size_t size);
+    void flush();
+
+    static constexpr std::size_t flush_threshold = 1UL << 16U;
+
+    bytecode::Program          m_program;
+    // Every string back to back, as the native .rodata. Its buffer is
+    // referenced by the threaded code and survives moves, unlike a string's.
+    std::vector<char>          m_pool;
+    std::vector<Cell>          m_code;
+    // Cell where main starts
+    std::size_t                m_entry = 0;
+    std::vector<std::uint64_t> m_stack;
+    fmt::memory_buffer         m_output;
+};
+
+} // namespace vm
+
+/// {fmt} Custom Formatters
+
+template<>
+struct fmt::formatter<vm::VmError> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const vm::VmError& error, FormatContext& ctx) {
+        static_assert(
+          std::to_underlying(vm::VmError::Max) == 4,
+          "[INTERNAL ERROR] fmt::formatter<vm::VmError> requires to handle all "
+          "enum variants"
+        );
+
+        const auto enum_to_str = [](const vm::VmError& error) {
+            switch (error) {
+                case vm::VmError::MissingMain: {
+                    return "VmError::MissingMain";
+                }
+                case vm::VmError::InvalidBytecode: {
+                    return "VmError::InvalidBytecode";
+                }
+                case vm::VmError::StackUnderflow: {
+                    return "VmError::StackUnderflow";
+                }
+                case vm::VmError::StackOverflow: {
+                    return "VmError::StackOverflow";
+                }
+                default: {
+                    return "Unknown Vm Error";
+                }
+            }
+        };
+
+        return fmt::format_to(ctx.out(), "{}", enum_to_str(error));
+    }
+};
+
+#endif // VM_HPP
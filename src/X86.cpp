@@ -0,0 +1,741 @@
+#include "X86.hpp"
+
+#include <initializer_list>
+#include <limits>
+
+namespace {
+
+using x86::EncodeError;
+using x86::Fixup;
+using x86::FixupKind;
+using x86::Immediate;
+using x86::Instruction;
+using x86::Label;
+using x86::Memory;
+using x86::Mnemonic;
+using x86::Operand;
+using x86::Register;
+using x86::Width;
+
+[[nodiscard]] constexpr auto fits_i8(const std::int64_t value) -> bool {
+    return value >= std::numeric_limits<std::int8_t>::min()
+           && value <= std::numeric_limits<std::int8_t>::max();
+}
+
+[[nodiscard]] constexpr auto fits_i32(const std::int64_t value) -> bool {
+    return value >= std::numeric_limits<std::int32_t>::min()
+           && value <= std::numeric_limits<std::int32_t>::max();
+}
+
+[[nodiscard]] constexpr auto fits_u32(const std::int64_t value) -> bool {
+    return value >= 0 && value <= std::numeric_limits<std::uint32_t>::max();
+}
+
+/// spl, bpl, sil and dil only exist with a REX prefix, without one the same
+/// numbers mean ah, ch, dh and bh
+[[nodiscard]] constexpr auto needs_rex(const Register reg) -> bool {
+    return x86::width(reg) == Width::Byte && x86::number(reg) >= 4
+           && x86::number(reg) < 8;
+}
+
+/// Writes one instruction: [REX] opcode [ModRM [SIB] [disp]] [immediate]
+class Encoder {
+  public:
+    Encoder(std::vector<std::uint8_t>& code, std::vector<Fixup>& fixups)
+      : m_code{ code },
+        m_fixups{ fixups },
+        m_first_fixup{ fixups.size() } {}
+
+    void byte(const std::uint8_t value) { this->m_code.push_back(value); }
+
+    void bytes(const std::initializer_list<std::uint8_t> values) {
+        this->m_code.insert(this->m_code.end(), values);
+    }
+
+    void immediate(const std::int64_t value, const std::size_t size) {
+        auto bits = static_cast<std::uint64_t>(value);
+        for (std::size_t idx = 0; idx < size; ++idx) {
+            this->byte(static_cast<std::uint8_t>(bits & 0xFFU));
+            bits >>= 8U;
+        }
+    }
+
+    void fixup(
+      const FixupKind    kind,
+      const std::string& symbol,
+      const std::int64_t addend
+    ) {
+        this->m_fixups.push_back(
+          Fixup{ this->m_code.size(), kind, symbol, addend }
+        );
+        this->immediate(0, 4);
+    }
+
+    /// Opcode with the register number in its low bits (push, pop, mov imm)
+    void opcode_plus_register(
+      const std::uint8_t opcode,
+      const bool         wide,
+      const Register     reg
+    ) {
+        this->rex(wide, false, false, x86::number(reg) >= 8, needs_rex(reg));
+        this->byte(static_cast<std::uint8_t>(opcode + (x86::number(reg) & 7U)));
+    }
+
+    /// Opcode followed by a ModRM byte addressing `rm`, `reg_field` is either
+    /// a register or an opcode extension
+    [[nodiscard]] auto modrm(
+      const std::initializer_list<std::uint8_t> opcode,
+      const bool                                wide,
+      const std::uint8_t                        reg_field,
+      const bool                                reg_field_rex,
+      const Operand&                            rm
+    ) -> bool {
+        const auto reg_high = reg_field >= 8;
+
+        if (const auto* reg = std::get_if<Register>(&rm)) {
+            this->rex(
+              wide,
+              reg_high,
+              false,
+              x86::number(*reg) >= 8,
+              reg_field_rex || needs_rex(*reg)
+            );
+            this->bytes(opcode);
+            this->byte(static_cast<std::uint8_t>(
+              0xC0U | ((reg_field & 7U) << 3U) | (x86::number(*reg) & 7U)
+            ));
+            return true;
+        }
+
+        const auto* memory = std::get_if<Memory>(&rm);
+        if (memory == nullptr) { return false; }
+
+        // RIP relative
+        if (!memory->symbol.empty()) {
+            this->rex(wide, reg_high, false, false, reg_field_rex);
+            this->bytes(opcode);
+            this->byte(
+              static_cast<std::uint8_t>(((reg_field & 7U) << 3U) | 5U)
+            );
+            this->fixup(
+              FixupKind::Relative32, memory->symbol, memory->displacement
+            );
+            return true;
+        }
+
+        const auto scale_bits = [&]() -> std::optional<std::uint8_t> {
+            switch (memory->scale) {
+                case 1: {
+                    return 0;
+                }
+                case 2: {
+                    return 1;
+                }
+                case 4: {
+                    return 2;
+                }
+                case 8: {
+                    return 3;
+                }
+                default: {
+                    return std::nullopt;
+                }
+            }
+        }();
+        if (!scale_bits.has_value()) { return false; }
+
+        // rsp cannot be an index, that encoding means "no index"
+        if (memory->index.has_value()
+            && x86::number(memory->index.value()) == 4) {
+            return false;
+        }
+        if ((memory->base.has_value()
+             && x86::width(memory->base.value()) != Width::Qword)
+            || (memory->index.has_value()
+                && x86::width(memory->index.value()) != Width::Qword)) {
+            return false;
+        }
+
+        const std::uint8_t index =
+          memory->index.has_value() ? x86::number(memory->index.value()) : 4;
+        const std::uint8_t base =
+          memory->base.has_value() ? x86::number(memory->base.value()) : 5;
+
+        this->rex(
+          wide, reg_high, index >= 8, memory->base.has_value() && base >= 8,
+          reg_field_rex
+        );
+        this->bytes(opcode);
+
+        const auto reg_bits = static_cast<std::uint8_t>((reg_field & 7U) << 3U);
+
+        // No base: absolute or index-only, always a 32-bit displacement
+        if (!memory->base.has_value()) {
+            this->byte(static_cast<std::uint8_t>(reg_bits | 4U));
+            this->byte(static_cast<std::uint8_t>(
+              (scale_bits.value() << 6U) | ((index & 7U) << 3U) | 5U
+            ));
+            this->immediate(memory->displacement, 4);
+            return true;
+        }
+
+        // rbp and r13 as base always need a displacement, mod 00 means RIP
+        // relative or no base with them
+        const auto mod = [&]() -> std::uint8_t {
+            if (memory->displacement == 0 && (base & 7U) != 5) { return 0; }
+            if (fits_i8(memory->displacement)) { return 1; }
+            return 2;
+        }();
+
+        // rsp and r12 as base can only be expressed through a SIB byte
+        const auto needs_sib = memory->index.has_value() || (base & 7U) == 4;
+        if (needs_sib) {
+            this->byte(static_cast<std::uint8_t>((mod << 6U) | reg_bits | 4U));
+            this->byte(static_cast<std::uint8_t>(
+              (scale_bits.value() << 6U) | ((index & 7U) << 3U) | (base & 7U)
+            ));
+        } else {
+            this->byte(
+              static_cast<std::uint8_t>((mod << 6U) | reg_bits | (base & 7U))
+            );
+        }
+
+        if (mod == 1) { this->immediate(memory->displacement, 1); }
+        if (mod == 2) { this->immediate(memory->displacement, 4); }
+        return true;
+    }
+
+    /// Relative fixups are measured from the end of the instruction, which is
+    /// only known once its immediate, if any, has been written
+    void finish() {
+        const auto end = this->m_code.size();
+        for (auto idx = this->m_first_fixup; idx < this->m_fixups.size();
+             ++idx) {
+            auto& fixup = this->m_fixups[idx];
+            if (fixup.kind == FixupKind::Relative32) {
+                fixup.addend -= static_cast<std::int64_t>(end - fixup.offset);
+            }
+        }
+    }
+
+  private:
+    void rex(
+      const bool wide,
+      const bool reg_high,
+      const bool index_high,
+      const bool base_high,
+      const bool force
+    ) {
+        const auto value = static_cast<std::uint8_t>(
+          0x40U | (wide ? 8U : 0U) | (reg_high ? 4U : 0U)
+          | (index_high ? 2U : 0U) | (base_high ? 1U : 0U)
+        );
+        if (value != 0x40U || force) { this->byte(value); }
+    }
+
+    std::vector<std::uint8_t>& m_code;
+    std::vector<Fixup>&        m_fixups;
+    std::size_t                m_first_fixup;
+};
+
+[[nodiscard]] auto
+  operand_width(const Operand& operand) -> std::optional<Width> {
+    if (const auto* reg = std::get_if<Register>(&operand)) {
+        return x86::width(*reg);
+    }
+    if (const auto* memory = std::get_if<Memory>(&operand)) {
+        return memory->width;
+    }
+    return std::nullopt;
+}
+
+[[nodiscard]] auto encode_mov(Encoder& encoder, const Instruction& instruction)
+  -> bool {
+    const auto& dst = instruction.destination;
+    const auto& src = instruction.source;
+
+    const auto dst_width = operand_width(dst);
+    if (!dst_width.has_value()) { return false; }
+    const auto wide = dst_width == Width::Qword;
+    const auto byte = dst_width == Width::Byte;
+
+    if (const auto* immediate = std::get_if<Immediate>(&src)) {
+        const auto value = immediate->value;
+
+        if (const auto* reg = std::get_if<Register>(&dst)) {
+            if (byte) {
+                encoder.opcode_plus_register(0xB0, false, *reg);
+                encoder.immediate(value, 1);
+                return true;
+            }
+            // Writing a 32-bit register clears the upper half, so the short
+            // form covers every unsigned 32-bit value
+            if (fits_u32(value) || (!wide && fits_i32(value))) {
+                encoder.opcode_plus_register(0xB8, false, *reg);
+                encoder.immediate(value, 4);
+                return true;
+            }
+            if (!wide) { return false; }
+            if (fits_i32(value)) {
+                if (!encoder.modrm({ 0xC7 }, true, 0, false, dst)) {
+                    return false;
+                }
+                encoder.immediate(value, 4);
+                return true;
+            }
+            encoder.opcode_plus_register(0xB8, true, *reg);
+            encoder.immediate(value, 8);
+            return true;
+        }
+
+        if (!fits_i32(value)) { return false; }
+        const std::uint8_t opcode = byte ? 0xC6 : 0xC7;
+        if (!encoder.modrm({ opcode }, wide, 0, false, dst)) { return false; }
+        encoder.immediate(value, byte ? 1 : 4);
+        return true;
+    }
+
+    if (const auto* src_reg = std::get_if<Register>(&src)) {
+        if (x86::width(*src_reg) != dst_width) { return false; }
+        return encoder.modrm(
+          { byte ? std::uint8_t{ 0x88 } : std::uint8_t{ 0x89 } },
+          wide,
+          x86::number(*src_reg),
+          needs_rex(*src_reg),
+          dst
+        );
+    }
+
+    if (std::holds_alternative<Memory>(src)) {
+        const auto* dst_reg = std::get_if<Register>(&dst);
+        if (dst_reg == nullptr || operand_width(src) != dst_width) {
+            return false;
+        }
+        return encoder.modrm(
+          { byte ? std::uint8_t{ 0x8A } : std::uint8_t{ 0x8B } },
+          wide,
+          x86::number(*dst_reg),
+          needs_rex(*dst_reg),
+          src
+        );
+    }
+
+    return false;
+}
+
+/// add, or, and, sub, xor and cmp share their encodings, only the opcode
+/// extension (and the matching opcode row) differ
+[[nodiscard]] auto encode_arithmetic(
+  Encoder&           encoder,
+  const Instruction& instruction,
+  const std::uint8_t extension
+) -> bool {
+    const auto& dst = instruction.destination;
+    const auto& src = instruction.source;
+
+    const auto dst_width = operand_width(dst);
+    if (!dst_width.has_value()) { return false; }
+    const auto wide = dst_width == Width::Qword;
+    const auto byte = dst_width == Width::Byte;
+    const auto row  = static_cast<std::uint8_t>(extension << 3U);
+
+    if (const auto* immediate = std::get_if<Immediate>(&src)) {
+        const auto value = immediate->value;
+        if (byte) {
+            if (!encoder.modrm({ 0x80 }, false, extension, false, dst)) {
+                return false;
+            }
+            encoder.immediate(value, 1);
+            return true;
+        }
+        if (fits_i8(value)) {
+            if (!encoder.modrm({ 0x83 }, wide, extension, false, dst)) {
+                return false;
+            }
+            encoder.immediate(value, 1);
+            return true;
+        }
+        if (!fits_i32(value)) { return false; }
+
+        // Short form without ModRM when the destination is the accumulator
+        if (const auto* reg = std::get_if<Register>(&dst);
+            reg != nullptr && x86::number(*reg) == 0) {
+            encoder.opcode_plus_register(
+              static_cast<std::uint8_t>(row | 5U), wide, *reg
+            );
+            encoder.immediate(value, 4);
+            return true;
+        }
+
+        if (!encoder.modrm({ 0x81 }, wide, extension, false, dst)) {
+            return false;
+        }
+        encoder.immediate(value, 4);
+        return true;
+    }
+
+    if (const auto* src_reg = std::get_if<Register>(&src)) {
+        if (x86::width(*src_reg) != dst_width) { return false; }
+        return encoder.modrm(
+          { static_cast<std::uint8_t>(row | (byte ? 0U : 1U)) },
+          wide,
+          x86::number(*src_reg),
+          needs_rex(*src_reg),
+          dst
+        );
+    }
+
+    if (std::holds_alternative<Memory>(src)) {
+        const auto* dst_reg = std::get_if<Register>(&dst);
+        if (dst_reg == nullptr || operand_width(src) != dst_width) {
+            return false;
+        }
+        return encoder.modrm(
+          { static_cast<std::uint8_t>(row | (byte ? 2U : 3U)) },
+          wide,
+          x86::number(*dst_reg),
+          needs_rex(*dst_reg),
+          src
+        );
+    }
+
+    return false;
+}
+
+/// mul, div, idiv and neg: F7 with an opcode extension and one operand
+[[nodiscard]] auto encode_unary(
+  Encoder&           encoder,
+  const Instruction& instruction,
+  const std::uint8_t extension
+) -> bool {
+    const auto width = operand_width(instruction.destination);
+    if (!width.has_value()
+        || !std::holds_alternative<std::monostate>(instruction.source)) {
+        return false;
+    }
+    return encoder.modrm(
+      { width == Width::Byte ? std::uint8_t{ 0xF6 } : std::uint8_t{ 0xF7 } },
+      width == Width::Qword,
+      extension,
+      false,
+      instruction.destination
+    );
+}
+
+[[nodiscard]] auto encode_shift(
+  Encoder&           encoder,
+  const Instruction& instruction,
+  const std::uint8_t extension
+) -> bool {
+    const auto width = operand_width(instruction.destination);
+    if (!width.has_value() || width == Width::Byte) { return false; }
+    const auto wide = width == Width::Qword;
+
+    if (const auto* count = std::get_if<Register>(&instruction.source)) {
+        if (*count != Register::Cl) { return false; }
+        return encoder.modrm(
+          { 0xD3 }, wide, extension, false, instruction.destination
+        );
+    }
+
+    const auto* count = std::get_if<Immediate>(&instruction.source);
+    if (count == nullptr || count->value < 0 || count->value > 63) {
+        return false;
+    }
+    if (count->value == 1) {
+        return encoder.modrm(
+          { 0xD1 }, wide, extension, false, instruction.destination
+        );
+    }
+    if (!encoder.modrm(
+          { 0xC1 }, wide, extension, false, instruction.destination
+        )) {
+        return false;
+    }
+    encoder.immediate(count->value, 1);
+    return true;
+}
+
+[[nodiscard]] auto encode_imul(Encoder& encoder, const Instruction& instruction)
+  -> bool {
+    const auto* dst = std::get_if<Register>(&instruction.destination);
+    if (dst == nullptr || x86::width(*dst) == Width::Byte) { return false; }
+    const auto wide = x86::width(*dst) == Width::Qword;
+
+    if (const auto* immediate = std::get_if<Immediate>(&instruction.source)) {
+        const auto short_form = fits_i8(immediate->value);
+        if (!short_form && !fits_i32(immediate->value)) { return false; }
+        if (!encoder.modrm(
+              { short_form ? std::uint8_t{ 0x6B } : std::uint8_t{ 0x69 } },
+              wide,
+              x86::number(*dst),
+              false,
+              *dst
+            )) {
+            return false;
+        }
+        encoder.immediate(immediate->value, short_form ? 1 : 4);
+        return true;
+    }
+
+    if (operand_width(instruction.source) != x86::width(*dst)) {
+        return false;
+    }
+    return encoder.modrm(
+      { 0x0F, 0xAF }, wide, x86::number(*dst), false, instruction.source
+    );
+}
+
+[[nodiscard]] auto condition_code(const Mnemonic mnemonic)
+  -> std::optional<std::uint8_t> {
+    switch (mnemonic) {
+        case Mnemonic::Jb: {
+            return 0x2;
+        }
+        case Mnemonic::Jae: {
+            return 0x3;
+        }
+        case Mnemonic::Je: {
+            return 0x4;
+        }
+        case Mnemonic::Jne: {
+            return 0x5;
+        }
+        case Mnemonic::Jbe: {
+            return 0x6;
+        }
+        case Mnemonic::Ja: {
+            return 0x7;
+        }
+        case Mnemonic::Jl: {
+            return 0xC;
+        }
+        case Mnemonic::Jge: {
+            return 0xD;
+        }
+        case Mnemonic::Jle: {
+            return 0xE;
+        }
+        case Mnemonic::Jg: {
+            return 0xF;
+        }
+        default: {
+            return std::nullopt;
+        }
+    }
+}
+
+} // namespace
+
+namespace x86 {
+
+auto encode(
+  const Instruction&         instruction,
+  std::vector<std::uint8_t>& code,
+  std::vector<Fixup>&        fixups
+) -> std::expected<void, EncodeError> {
+    static_assert(
+      std::to_underlying(Mnemonic::Max) == 35,
+      "[INTERNAL ERROR] x86::encode() requires to handle all mnemonics"
+    );
+
+    const auto start = code.size();
+    const auto first_fixup = fixups.size();
+    Encoder    encoder(code, fixups);
+
+    const auto& dst = instruction.destination;
+    const auto& src = instruction.source;
+
+    const auto encoded = [&]() -> bool {
+        switch (instruction.mnemonic) {
+            case Mnemonic::Mov: {
+                return encode_mov(encoder, instruction);
+            }
+            case Mnemonic::Lea: {
+                const auto* reg = std::get_if<Register>(&dst);
+                if (reg == nullptr || width(*reg) != Width::Qword
+                    || !std::holds_alternative<Memory>(src)) {
+                    return false;
+                }
+                return encoder.modrm({ 0x8D }, true, number(*reg), false, src);
+            }
+            case Mnemonic::Push: {
+                if (const auto* reg = std::get_if<Register>(&dst)) {
+                    if (width(*reg) != Width::Qword) { return false; }
+                    encoder.opcode_plus_register(0x50, false, *reg);
+                    return true;
+                }
+                if (const auto* immediate = std::get_if<Immediate>(&dst)) {
+                    if (fits_i8(immediate->value)) {
+                        encoder.byte(0x6A);
+                        encoder.immediate(immediate->value, 1);
+                        return true;
+                    }
+                    if (!fits_i32(immediate->value)) { return false; }
+                    encoder.byte(0x68);
+                    encoder.immediate(immediate->value, 4);
+                    return true;
+                }
+                if (const auto* label = std::get_if<Label>(&dst)) {
+                    encoder.byte(0x68);
+                    encoder.fixup(FixupKind::Absolute32, label->name, 0);
+                    return true;
+                }
+                return encoder.modrm({ 0xFF }, false, 6, false, dst);
+            }
+            case Mnemonic::Pop: {
+                if (const auto* reg = std::get_if<Register>(&dst)) {
+                    if (width(*reg) != Width::Qword) { return false; }
+                    encoder.opcode_plus_register(0x58, false, *reg);
+                    return true;
+                }
+                return encoder.modrm({ 0x8F }, false, 0, false, dst);
+            }
+            case Mnemonic::Add: {
+                return encode_arithmetic(encoder, instruction, 0);
+            }
+            case Mnemonic::Or: {
+                return encode_arithmetic(encoder, instruction, 1);
+            }
+            case Mnemonic::And: {
+                return encode_arithmetic(encoder, instruction, 4);
+            }
+            case Mnemonic::Sub: {
+                return encode_arithmetic(encoder, instruction, 5);
+            }
+            case Mnemonic::Xor: {
+                return encode_arithmetic(encoder, instruction, 6);
+            }
+            case Mnemonic::Cmp: {
+                return encode_arithmetic(encoder, instruction, 7);
+            }
+            case Mnemonic::Test: {
+                const auto dst_width = operand_width(dst);
+                const auto* src_reg  = std::get_if<Register>(&src);
+                if (src_reg == nullptr || width(*src_reg) != dst_width) {
+                    return false;
+                }
+                return encoder.modrm(
+                  { dst_width == Width::Byte ? std::uint8_t{ 0x84 }
+                                             : std::uint8_t{ 0x85 } },
+                  dst_width == Width::Qword,
+                  number(*src_reg),
+                  needs_rex(*src_reg),
+                  dst
+                );
+            }
+            case Mnemonic::Imul: {
+                return encode_imul(encoder, instruction);
+            }
+            case Mnemonic::Mul: {
+                return encode_unary(encoder, instruction, 4);
+            }
+            case Mnemonic::Div: {
+                return encode_unary(encoder, instruction, 6);
+            }
+            case Mnemonic::Idiv: {
+                return encode_unary(encoder, instruction, 7);
+            }
+            case Mnemonic::Neg: {
+                return encode_unary(encoder, instruction, 3);
+            }
+            case Mnemonic::Cqo: {
+                encoder.bytes({ 0x48, 0x99 });
+                return true;
+            }
+            case Mnemonic::Shl: {
+                return encode_shift(encoder, instruction, 4);
+            }
+            case Mnemonic::Shr: {
+                return encode_shift(encoder, instruction, 5);
+            }
+            case Mnemonic::Sar: {
+                return encode_shift(encoder, instruction, 7);
+            }
+            case Mnemonic::Bsr: {
+                const auto* reg = std::get_if<Register>(&dst);
+                if (reg == nullptr || width(*reg) == Width::Byte
+                    || operand_width(src) != width(*reg)) {
+                    return false;
+                }
+                return encoder.modrm(
+                  { 0x0F, 0xBD },
+                  width(*reg) == Width::Qword,
+                  number(*reg),
+                  false,
+                  src
+                );
+            }
+            case Mnemonic::Call: {
+                if (const auto* label = std::get_if<Label>(&dst)) {
+                    encoder.byte(0xE8);
+                    encoder.fixup(FixupKind::Relative32, label->name, 0);
+                    return true;
+                }
+                return encoder.modrm({ 0xFF }, false, 2, false, dst);
+            }
+            case Mnemonic::Ret: {
+                encoder.byte(0xC3);
+                return true;
+            }
+            case Mnemonic::Syscall: {
+                encoder.bytes({ 0x0F, 0x05 });
+                return true;
+            }
+            case Mnemonic::Jmp: {
+                const auto* label = std::get_if<Label>(&dst);
+                if (label == nullptr) { return false; }
+                encoder.byte(0xE9);
+                encoder.fixup(FixupKind::Relative32, label->name, 0);
+                return true;
+            }
+            default: {
+                const auto condition = condition_code(instruction.mnemonic);
+                const auto* label    = std::get_if<Label>(&dst);
+                if (!condition.has_value() || label == nullptr) {
+                    return false;
+                }
+                encoder.bytes(
+                  { 0x0F, static_cast<std::uint8_t>(0x80U | *condition) }
+                );
+                encoder.fixup(FixupKind::Relative32, label->name, 0);
+                return true;
+            }
+        }
+    }();
+
+    if (!encoded) {
+        code.resize(start);
+        fixups.resize(first_fixup);
+        return std::unexpected(EncodeError::InvalidOperands);
+    }
+
+    encoder.finish();
+    return {};
+}
+
+auto to_string(const Register reg) -> std::string_view {
+    static constexpr auto count = std::to_underlying(Register::Max);
+    static constexpr std::array<std::string_view, count> names = {
+        "rax", "rcx", "rdx",  "rbx",  "rsp",  "rbp",  "rsi",  "rdi",
+        "r8",  "r9",  "r10",  "r11",  "r12",  "r13",  "r14",  "r15",
+        "eax", "ecx", "edx",  "ebx",  "esp",  "ebp",  "esi",  "edi",
+        "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d",
+        "al",  "cl",  "dl",   "bl",   "spl",  "bpl",  "sil",  "dil",
+        "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b",
+    };
+    return names[std::to_underlying(reg)];
+}
+
+auto to_string(const Mnemonic mnemonic) -> std::string_view {
+    static constexpr auto count = std::to_underlying(Mnemonic::Max);
+    static constexpr std::array<std::string_view, count> names = {
+        "mov",  "lea", "push", "pop", "add", "sub", "imul", "mul", "div",
+        "idiv", "cqo", "neg",  "and", "or",  "xor", "cmp",  "test", "shl",
+        "shr",  "sar", "bsr",  "call", "ret", "syscall", "jmp", "je", "jne",
+        "ja",   "jae", "jb",   "jbe", "jg",  "jge",  "jl",  "jle",
+    };
+    return names[std::to_underlying(mnemonic)];
+}
+
+} // namespace x86
@@ -0,0 +1,360 @@
+#ifndef X86_HPP
+#define X86_HPP
+
+#define FMT_HEADER_ONLY
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <fmt/format.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// The subset of x86-64 the code generator emits.
+///
+/// Instructions are built once as plain values and then either rendered as
+/// NASM source through their fmt::formatter or encoded to machine code by
+/// x86::encode, so both backends always agree on what was generated.
+namespace x86 {
+
+enum class Register : std::uint8_t {
+    // 64 bits, in encoding order
+    Rax = 0,
+    Rcx,
+    Rdx,
+    Rbx,
+    Rsp,
+    Rbp,
+    Rsi,
+    Rdi,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+    // 32 bits
+    Eax,
+    Ecx,
+    Edx,
+    Ebx,
+    Esp,
+    Ebp,
+    Esi,
+    Edi,
+    R8d,
+    R9d,
+    R10d,
+    R11d,
+    R12d,
+    R13d,
+    R14d,
+    R15d,
+    // 8 bits
+    Al,
+    Cl,
+    Dl,
+    Bl,
+    Spl,
+    Bpl,
+    Sil,
+    Dil,
+    R8b,
+    R9b,
+    R10b,
+    R11b,
+    R12b,
+    R13b,
+    R14b,
+    R15b,
+    Max
+};
+
+enum class Width : std::uint8_t {
+    Byte  = 1,
+    Dword = 4,
+    Qword = 8,
+};
+
+/// 4-bit register number used by the encoding
+[[nodiscard]] constexpr auto number(const Register reg) -> std::uint8_t {
+    return std::to_underlying(reg) & 0xFU;
+}
+
+[[nodiscard]] constexpr auto width(const Register reg) -> Width {
+    switch (std::to_underlying(reg) >> 4U) {
+        case 0: {
+            return Width::Qword;
+        }
+        case 1: {
+            return Width::Dword;
+        }
+        default: {
+            return Width::Byte;
+        }
+    }
+}
+
+/// Same register number at another width, e.g. Rax -> Eax
+[[nodiscard]] constexpr auto
+  resize(const Register reg, const Width target) -> Register {
+    const auto bank = [&]() -> std::uint8_t {
+        switch (target) {
+            case Width::Qword: {
+                return 0;
+            }
+            case Width::Dword: {
+                return 16;
+            }
+            default: {
+                return 32;
+            }
+        }
+    }();
+    return static_cast<Register>(bank + number(reg));
+}
+
+struct Immediate {
+    std::int64_t value;
+};
+
+/// Address of a label or symbol, resolved by the assembler or the linker
+struct Label {
+    std::string name;
+};
+
+/// [base + index * scale + displacement], or [rel symbol + displacement]
+/// when `symbol` is set
+struct Memory {
+    Width                   width = Width::Qword;
+    std::optional<Register> base{};
+    std::optional<Register> index{};
+    std::uint8_t            scale        = 1;
+    std::int32_t            displacement = 0;
+    std::string             symbol{};
+};
+
+using Operand =
+  std::variant<std::monostate, Register, Immediate, Memory, Label>;
+
+enum class Mnemonic : std::uint8_t {
+    Mov = 0,
+    Lea,
+    Push,
+    Pop,
+    Add,
+    Sub,
+    Imul,
+    Mul,
+    Div,
+    Idiv,
+    Cqo,
+    Neg,
+    And,
+    Or,
+    Xor,
+    Cmp,
+    Test,
+    Shl,
+    Shr,
+    Sar,
+    // Index of the highest set bit, undefined for 0
+    Bsr,
+    Call,
+    Ret,
+    Syscall,
+    Jmp,
+    Je,
+    Jne,
+    Ja,
+    Jae,
+    Jb,
+    Jbe,
+    Jg,
+    Jge,
+    Jl,
+    Jle,
+    Max
+};
+
+struct Instruction {
+    Mnemonic mnemonic;
+    Operand  destination{};
+    Operand  source{};
+};
+
+enum class EncodeError : std::uint8_t {
+    InvalidOperands = 0,
+    Max
+};
+
+enum class FixupKind : std::uint8_t {
+    // 32-bit displacement relative to the end of the field's instruction,
+    // used by calls, jumps and RIP-relative memory operands
+    Relative32 = 0,
+    // 32-bit absolute address, sign-extended by the CPU
+    Absolute32,
+    Max
+};
+
+/// A 4-byte field of the encoded code that refers to a label. The value to
+/// store is `address(symbol) + addend - address(field)` for relative fixups,
+/// and `address(symbol) + addend` for absolute ones.
+struct Fixup {
+    std::size_t  offset;
+    FixupKind    kind;
+    std::string  symbol;
+    std::int64_t addend;
+};
+
+/// Appends the machine code of `instruction` to `code`, label references are
+/// left as zeros and described in `fixups`
+[[nodiscard]] auto encode(
+  const Instruction&         instruction,
+  std::vector<std::uint8_t>& code,
+  std::vector<Fixup>&        fixups
+) -> std::expected<void, EncodeError>;
+
+[[nodiscard]] auto to_string(const Register reg) -> std::string_view;
+[[nodiscard]] auto to_string(const Mnemonic mnemonic) -> std::string_view;
+
+} // namespace x86
+
+/// {fmt} Custom Formatters
+
+/// Renders an operand in NASM syntax
+template<>
+struct fmt::formatter<x86::Operand> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const x86::Operand& operand, FormatContext& ctx) {
+        if (const auto* reg = std::get_if<x86::Register>(&operand)) {
+            return fmt::format_to(ctx.out(), "{}", x86::to_string(*reg));
+        }
+        if (const auto* immediate = std::get_if<x86::Immediate>(&operand)) {
+            return fmt::format_to(ctx.out(), "{}", immediate->value);
+        }
+        if (const auto* label = std::get_if<x86::Label>(&operand)) {
+            return fmt::format_to(ctx.out(), "{}", label->name);
+        }
+        if (const auto* memory = std::get_if<x86::Memory>(&operand)) {
+            auto out = fmt::format_to(ctx.out(), "[");
+            if (!memory->symbol.empty()) {
+                out = fmt::format_to(out, "rel {}", memory->symbol);
+            } else {
+                const char* separator = "";
+                if (memory->base.has_value()) {
+                    out = fmt::format_to(
+                      out, "{}", x86::to_string(memory->base.value())
+                    );
+                    separator = "+";
+                }
+                if (memory->index.has_value()) {
+                    out = fmt::format_to(
+                      out,
+                      "{}{}*{}",
+                      separator,
+                      x86::to_string(memory->index.value()),
+                      memory->scale
+                    );
+                }
+            }
+            if (memory->displacement > 0) {
+                out = fmt::format_to(out, "+{}", memory->displacement);
+            } else if (memory->displacement < 0) {
+                out = fmt::format_to(out, "{}", memory->displacement);
+            }
+            return fmt::format_to(out, "]");
+        }
+        return ctx.out();
+    }
+};
+
+/// Renders an instruction as one line of NASM source, without indentation
+template<>
+struct fmt::formatter<x86::Instruction> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const x86::Instruction& instruction, FormatContext& ctx) {
+        auto out = fmt::format_to(
+          ctx.out(), "{}", x86::to_string(instruction.mnemonic)
+        );
+
+        if (std::holds_alternative<std::monostate>(instruction.destination)) {
+            return out;
+        }
+
+        // The operand size of a memory operand is only implied by a register
+        const auto* memory = std::get_if<x86::Memory>(&instruction.destination);
+        if (memory != nullptr
+            && !std::holds_alternative<x86::Register>(instruction.source)) {
+            switch (memory->width) {
+                case x86::Width::Byte: {
+                    out = fmt::format_to(out, " BYTE");
+                    break;
+                }
+                case x86::Width::Dword: {
+                    out = fmt::format_to(out, " DWORD");
+                    break;
+                }
+                case x86::Width::Qword: {
+                    out = fmt::format_to(out, " QWORD");
+                    break;
+                }
+            }
+        }
+
+        out = fmt::format_to(out, " {}", instruction.destination);
+        if (std::holds_alternative<std::monostate>(instruction.source)) {
+            return out;
+        }
+        return fmt::format_to(out, ", {}", instruction.source);
+    }
+};
+
+template<>
+struct fmt::formatter<x86::EncodeError> {
+    template<typename ParseContext>
+    constexpr auto parse(ParseContext& ctx) {
+        return ctx.begin();
+    }
+
+    template<typename FormatContext>
+    auto format(const x86::EncodeError& error, FormatContext& ctx) {
+        static_assert(
+          std::to_underlying(x86::EncodeError::Max) == 1,
+          "[INTERNAL ERROR] fmt::formatter<x86::EncodeError> requires to "
+          "handle all enum variants"
+        );
+
+        const auto enum_to_str = [](const x86::EncodeError& error) {
+            switch (error) {
+                case x86::EncodeError::InvalidOperands: {
+                    return "EncodeError::InvalidOperands";
+                }
+                default: {
+                    return "Unknown Encode Error";
+                }
+            }
+        };
+
+        return fmt::format_to(ctx.out(), "{}", enum_to_str(error));
+    }
+};
+
+#endif // X86_HPP
@@ -6,7 +6,14 @@
 
 #include "Assembler.hpp"
 #include "Compiler.hpp"
+#include "Ir.hpp"
+#include "Jit.hpp"
 #include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Passes.hpp"
+#include "Peephole.hpp"
+#include "Simd.hpp"
+#include "Vm.hpp"
 
 static bool
   invoke_external_command(const std::string& command, const bool verbose) {
@@ -47,7 +54,195 @@ static bool
     return true;
 }
 
+/// Runtime library next to the running executable, where the build puts it,
+/// or else the installed one: in the library directory of the installation
+/// the executable belongs to, or last under the install prefix
+static auto default_runtime_library() -> std::string {
+    const auto installed =
+      std::filesystem::path(RACK_RUNTIME_INSTALL_DIR) / RACK_RUNTIME_NAME;
+
+    std::error_code error;
+    const auto      executable =
+      std::filesystem::read_symlink("/proc/self/exe", error);
+    if (error) { return installed.string(); }
+
+    const auto directory = executable.parent_path();
+    for (const auto& candidate :
+         { directory / RACK_RUNTIME_NAME,
+           directory / RACK_RUNTIME_LIBDIR / RACK_RUNTIME_NAME }) {
+        if (std::filesystem::exists(candidate, error)) {
+            return candidate.lexically_normal().string();
+        }
+    }
+    return installed.string();
+}
+
+/// -O0, -O1, -O2 and --print-ir, shared by every command generating code
+static void add_optimization_arguments(argparse::ArgumentParser& parser) {
+    parser.add_argument("-O0")
+      .help("no optimization (default)")
+      .default_value(false)
+      .implicit_value(true);
+    parser.add_argument("-O1")
+      .help("remove unused values")
+      .default_value(false)
+      .implicit_value(true);
+    parser.add_argument("-O2")
+      .help("-O1, and precompute what is known at compile time")
+      .default_value(false)
+      .implicit_value(true);
+    parser.add_argument("--print-ir")
+      .help("print the IR to stdout after lowering and after every pass")
+      .default_value(false)
+      .implicit_value(true);
+}
+
+/// Lowers the program and runs the pass pipeline selected by -O, errors are
+/// printed
+static auto optimize(
+  const argparse::ArgumentParser&  parser,
+  const std::shared_ptr<Compiler>& compiler,
+  const ast::Program&              program
+) -> std::optional<ir::Module> {
+    std::optional<OptimizationLevel> level;
+    for (const auto candidate :
+         { OptimizationLevel::O0, OptimizationLevel::O1, OptimizationLevel::O2 }
+    ) {
+        const auto flag = fmt::format("-O{}", std::to_underlying(candidate));
+        if (parser.get<bool>(flag)) {
+            if (level.has_value()) {
+                fmt::print(
+                  stderr,
+                  fmt::fg(fmt::color::red) | fmt::emphasis::bold,
+                  "error: "
+                );
+                fmt::print(
+                  stderr,
+                  fmt::emphasis::bold,
+                  "only one optimization level can be given\n"
+                );
+                return std::nullopt;
+            }
+            level = candidate;
+        }
+    }
+
+    auto module = ir::lower(compiler, program);
+    if (!module.has_value() || compiler->has_errors()) {
+        compiler->print_errors();
+        return std::nullopt;
+    }
+
+    PassManager::create(level.value_or(OptimizationLevel::O0))
+      .run(module.value(), parser.get<bool>("--print-ir"));
+    return std::move(module.value());
+}
+
+/// `rack run <file>`: compiles into memory and runs the program right away,
+/// without writing any file or spawning any process
+static int run_command(const int argc, const char** argv) {
+    argparse::ArgumentParser parser("rack run", "0.0.1");
+    parser.add_argument("file").help("path to rack file to run");
+    parser.add_argument("--vm")
+      .help("interpret bytecode instead of running native code")
+      .default_value(false)
+      .implicit_value(true);
+    add_optimization_arguments(parser);
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::runtime_error& err) {
+        fmt::print(
+          stderr, fmt::fg(fmt::color::red) | fmt::emphasis::bold, "error: "
+        );
+        fmt::print(stderr, fmt::emphasis::bold, "{}\n", err.what());
+        fmt::print(stderr, "{}\n", parser.help().str());
+        return 1;
+    }
+
+    const auto input_file = parser.get<std::string>("file");
+
+    const std::shared_ptr<Compiler> compiler =
+      Compiler::create(input_file, "");
+
+    auto tokens = TokenStream::create(compiler);
+    if (!tokens.has_value()) {
+        fmt::print(stderr, "[INTERNAL ERROR] lex error: {}\n", tokens.error());
+        compiler->print_errors();
+        return 1;
+    }
+
+    const auto program = Parser::parse(compiler, std::move(tokens.value()));
+    if (!program.has_value() || compiler->has_errors()) {
+        compiler->print_errors();
+        return 1;
+    }
+
+    const auto module = optimize(parser, compiler, program.value());
+    if (!module.has_value()) { return 1; }
+
+    if (parser["--vm"] == true) {
+        auto bytecode = BytecodeAssembler::assemble(module.value());
+        if (!bytecode.has_value()) {
+            fmt::print(
+              stderr, "[INTERNAL ERROR] assemble error: {}\n", bytecode.error()
+            );
+            return 1;
+        }
+
+        auto machine = vm::Vm::create(std::move(bytecode.value()));
+        if (!machine.has_value()) {
+            if (machine.error() == vm::VmError::MissingMain) {
+                fmt::print(stderr, fmt::fg(fmt::color::red), "error");
+                fmt::print(
+                  stderr,
+                  fmt::emphasis::bold,
+                  ": undefined symbol `func_main`\n"
+                );
+            } else {
+                fmt::print(stderr, "[ERROR] vm error: {}\n", machine.error());
+            }
+            return 1;
+        }
+
+        machine->run();
+        return 0;
+    }
+
+    const auto object = ElfAssembler_x86_64::assemble(module.value());
+    if (!object.has_value()) {
+        fmt::print(
+          stderr, "[INTERNAL ERROR] assemble error: {}\n", object.error()
+        );
+        return 1;
+    }
+
+    const auto loaded = jit::Module::load(object.value());
+    if (!loaded.has_value()) {
+        if (loaded.error() == jit::JitError::MissingMain) {
+            fmt::print(stderr, fmt::fg(fmt::color::red), "error");
+            fmt::print(
+              stderr, fmt::emphasis::bold, ": undefined symbol `func_main`\n"
+            );
+        } else {
+            fmt::print(
+              stderr, "[INTERNAL ERROR] jit error: {}\n", loaded.error()
+            );
+        }
+        return 1;
+    }
+
+    loaded->run();
+    return 0;
+}
+
 int main(const int argc, const char** argv) {
+    // Subcommands parse their own arguments, the top-level positional file
+    // would otherwise swallow the subcommand name
+    if (argc > 1 && std::string_view(argv[1]) == "run") {
+        return run_command(argc - 1, argv + 1);
+    }
+
     argparse::ArgumentParser parser("rack", "0.0.1");
     parser.add_argument("file").help("path to rack file to compile");
     parser.add_argument("-o", "--output").help("compiled binary output path");
@@ -60,10 +255,36 @@ int main(const int argc, const char** argv) {
       .default_value(false)
       .implicit_value(true)
       .help("prints lexed tokens to stdout");
+    parser.add_argument("--assembler")
+      .help("how object files are produced: builtin, or nasm")
+      .default_value(std::string("builtin"));
+    parser.add_argument("--linker")
+      .help("how executables are produced: ld, or builtin (no child process, "
+            "requires the builtin assembler)")
+      .default_value(std::string("ld"));
+    parser.add_argument("--runtime")
+      .help("runtime library the executable is linked with (looked up next "
+            "to rack, then where it is installed)")
+      .default_value(default_runtime_library());
+    parser.add_argument("-j", "--jobs")
+      .help("number of threads used to lex large sources (0: one per core)")
+      .default_value(1)
+      .scan<'i', int>();
+    parser.add_argument("--output-buffer")
+      .help("bytes of output the program gathers before writing them (0: "
+            "write on every puts and print)")
+      .default_value(static_cast<int>(OutputBuffering{}.size))
+      .scan<'i', int>();
+    parser.add_argument("--flush-on-newline")
+      .help("when the program's output is a terminal, write it out line by "
+            "line")
+      .default_value(false)
+      .implicit_value(true);
     parser.add_argument("-V", "--verbose")
       .default_value(false)
       .implicit_value(true)
       .help("print compilation phases, and executed commands to stdout");
+    add_optimization_arguments(parser);
 
     try {
         parser.parse_args(argc, argv);
@@ -76,6 +297,53 @@ int main(const int argc, const char** argv) {
     }
 
     const auto verbose = parser.get<bool>("--verbose");
+    const auto jobs    = [&]() -> std::size_t {
+        const auto requested = parser.get<int>("--jobs");
+        if (requested <= 0) {
+            return std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        return static_cast<std::size_t>(requested);
+    }();
+
+    const auto assembler = parser.get<std::string>("--assembler");
+    const auto linker    = parser.get<std::string>("--linker");
+
+    const auto usage_error = [&](const std::string& message) {
+        fmt::print(
+          stderr, fmt::fg(fmt::color::red) | fmt::emphasis::bold, "error: "
+        );
+        fmt::print(stderr, fmt::emphasis::bold, "{}\n", message);
+        return 1;
+    };
+    if (assembler != "builtin" && assembler != "nasm") {
+        return usage_error(fmt::format("unknown assembler `{}`", assembler));
+    }
+    if (linker != "ld" && linker != "builtin") {
+        return usage_error(fmt::format("unknown linker `{}`", linker));
+    }
+    const auto use_nasm       = assembler == "nasm";
+    const auto use_builtin_ld = linker == "builtin";
+    if (use_nasm && use_builtin_ld) {
+        return usage_error(
+          "the builtin linker requires the builtin assembler"
+        );
+    }
+
+    const auto output_buffer = parser.get<int>("--output-buffer");
+    if (output_buffer != 0
+        && (output_buffer < static_cast<int>(OutputBuffering::min_size)
+            || static_cast<std::size_t>(output_buffer)
+                 > OutputBuffering::max_size)) {
+        return usage_error(fmt::format(
+          "--output-buffer must be 0, or between {} and {}",
+          OutputBuffering::min_size,
+          OutputBuffering::max_size
+        ));
+    }
+    const OutputBuffering buffering{
+        .size             = static_cast<std::size_t>(output_buffer),
+        .flush_on_newline = parser.get<bool>("--flush-on-newline"),
+    };
 
     auto              input_file      = parser.get<std::string>("file");
     const auto        input_file_path = std::filesystem::path(input_file);
@@ -98,7 +366,24 @@ int main(const int argc, const char** argv) {
 
     const std::shared_ptr<Compiler> compiler =
       Compiler::create(input_file, output_file);
-    const auto tokens = Lexer::lex(compiler);
+
+    // Tokens are streamed into the parser as they are lexed, unless they
+    // have to be lexed up front: in parallel, or to be dumped first
+    auto tokens = [&]() -> std::expected<TokenStream, LexError> {
+        if (jobs == 1 && parser["--lexed-tokens"] == false) {
+            return TokenStream::create(compiler);
+        }
+
+        auto lexed = Lexer::lex(compiler, jobs);
+        if (!lexed.has_value()) { return std::unexpected(lexed.error()); }
+
+        if (parser["--lexed-tokens"] == true) {
+            for (const auto& token : lexed.value()) {
+                fmt::println("{}", Located<Token>{ *compiler, token });
+            }
+        }
+        return TokenStream::create(std::move(lexed.value()));
+    }();
 
     if (!tokens.has_value()) {
         fmt::print(stderr, "[INTERNAL ERROR] lex error: {}\n", tokens.error());
@@ -106,12 +391,34 @@ int main(const int argc, const char** argv) {
         return 1;
     }
 
-    if (parser["--lexed-tokens"] == true) {
-        for (const auto& token : tokens.value()) { fmt::println("{}", token); }
+    // Syntax errors stop the compilation before any code is generated
+    const auto program = Parser::parse(compiler, std::move(tokens.value()));
+    if (!program.has_value() || compiler->has_errors()) {
+        compiler->print_errors();
+        return 1;
     }
 
-    const auto compile_result =
-      Assembler_x86_64::compile(compiler, tokens.value());
+    const auto module = optimize(parser, compiler, program.value());
+    if (!module.has_value()) { return 1; }
+
+    x86::PeepholeStats peephole_stats{};
+    const auto         compile_result = [&]() {
+        if (use_nasm) {
+            return Assembler_x86_64::compile(
+              compiler, module.value(), buffering, peephole_stats
+            );
+        }
+        return ElfAssembler_x86_64::compile(
+          compiler,
+          module.value(),
+          parser.get<bool>("--generate-asm"),
+          use_builtin_ld ? ElfAssembler_x86_64::Output::Executable
+                         : ElfAssembler_x86_64::Output::Object,
+          buffering,
+          parser.get<std::string>("--runtime"),
+          peephole_stats
+        );
+    }();
 
     if (!compile_result.has_value()) {
         compiler->print_errors();
@@ -127,6 +434,17 @@ int main(const int argc, const char** argv) {
     const auto compilation_end = std::chrono::steady_clock::now();
 
     if (verbose) {
+        fmt::print(
+          stdout, "[INFO] Lexer scanning kernels........{}\n", simd::implementation()
+        );
+        for (std::size_t rule = 0; rule < peephole_stats.size(); ++rule) {
+            fmt::print(
+              stdout,
+              "[INFO] Peephole {}........{}\n",
+              x86::to_string(static_cast<x86::PeepholeRule>(rule)),
+              peephole_stats[rule]
+            );
+        }
         fmt::print(
           stdout,
           "[INFO] Compiled in........{:.2f}s\n",
@@ -137,36 +455,43 @@ int main(const int argc, const char** argv) {
         );
     }
 
+    // The builtin linker already wrote the executable
+    if (use_builtin_ld) { return 0; }
+
     const std::string output_assembly_file =
       fmt::format("{}.asm", output_file_path_without_extension);
     const std::string output_object_file =
       fmt::format("{}.o", output_file_path_without_extension);
 
-    // Now we can invoke nasm and then link
-    const std::string nasm_command = fmt::format(
-      "nasm -f elf64 {} -o {}", output_assembly_file, output_object_file
-    );
+    // The builtin assembler already wrote the object file, otherwise invoke
+    // nasm, and then link
+    if (use_nasm) {
+        const std::string nasm_command = fmt::format(
+          "nasm -f elf64 {} -o {}", output_assembly_file, output_object_file
+        );
 
-    if (!invoke_external_command(nasm_command, verbose)) { return 1; }
+        if (!invoke_external_command(nasm_command, verbose)) { return 1; }
+    }
 
-    const std::string ld_command =
-      fmt::format("ld {} -o {}", output_object_file, output_file_path.string());
+    // _start is in the runtime library, pulled in even when the program
+    // calls no builtin. Sections nothing reachable from it refers to are
+    // dropped: unused runtime routines and functions.
+    const std::string ld_command = fmt::format(
+      "ld --gc-sections -u _start {} {} -o {}",
+      output_object_file,
+      parser.get<std::string>("--runtime"),
+      output_file_path.string()
+    );
 
     if (!invoke_external_command(ld_command, verbose)) { return 1; }
 
     // Cleanup (delete intermediate files)
 
-    const std::string cleanup_command = [&]() {
-        if (parser["--generate-asm"] == true) {
-            return fmt::format("rm {}", output_object_file);
-        } else {
-            return fmt::format(
-              "rm {} {}", output_object_file, output_assembly_file
-            );
-        }
-    }();
-
-    if (!invoke_external_command(cleanup_command, verbose)) { return 1; }
+    std::error_code cleanup_error;
+    std::filesystem::remove(output_object_file, cleanup_error);
+    if (parser["--generate-asm"] == false) {
+        std::filesystem::remove(output_assembly_file, cleanup_error);
+    }
 
     return 0;
 }